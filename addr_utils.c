@@ -0,0 +1,47 @@
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include "addr_utils.h"
+
+int parse_ipv4_endpoint(const char *spec, struct sockaddr_in *addr) {
+    // Room for "255.255.255.255:65535"; anything longer cannot be valid
+    char host[INET_ADDRSTRLEN + 8];
+    size_t len = strlen(spec);
+    if (len >= sizeof(host)) {
+        return -1;
+    }
+    memcpy(host, spec, len + 1);
+
+    char *colon = strrchr(host, ':');
+    if (!colon || colon[1] == '\0') {
+        return -1;
+    }
+    *colon = '\0';
+    char *end;
+    long port = strtol(colon + 1, &end, 10);
+    if (*end != '\0' || port <= 0 || port > 65535) {
+        return -1;
+    }
+
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_port = htons((uint16_t)port);
+    return inet_pton(AF_INET, host, &addr->sin_addr) == 1 ? 0 : -1;
+}
+
+uint64_t hash_mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+uint64_t ipv4_endpoint_hash(const struct sockaddr_in *addr) {
+    return hash_mix64(((uint64_t)addr->sin_addr.s_addr << 16) | addr->sin_port);
+}
+
+int same_ipv4_endpoint(const struct sockaddr_in *a, const struct sockaddr_in *b) {
+    return a->sin_addr.s_addr == b->sin_addr.s_addr && a->sin_port == b->sin_port;
+}
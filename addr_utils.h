@@ -0,0 +1,41 @@
+#ifndef ADDR_UTILS_H
+#define ADDR_UTILS_H
+
+#include <stdint.h>
+#include <netinet/in.h>
+
+/**
+ * Parse an IPv4 endpoint written as "a.b.c.d:port"
+ *
+ * @param spec Endpoint text
+ * @param addr Address to fill in (sin_family, sin_addr and sin_port)
+ * @return 0 on success, -1 if the text is not a valid endpoint
+ */
+int parse_ipv4_endpoint(const char *spec, struct sockaddr_in *addr);
+
+/**
+ * 64-bit finalizer from splitmix64; spreads every input bit over the result
+ *
+ * @param x Value to mix
+ * @return Mixed value
+ */
+uint64_t hash_mix64(uint64_t x);
+
+/**
+ * Hash of an IPv4 address and port, e.g. for flow tables
+ *
+ * @param addr Endpoint
+ * @return 64-bit hash
+ */
+uint64_t ipv4_endpoint_hash(const struct sockaddr_in *addr);
+
+/**
+ * Compare the address and port of two IPv4 endpoints
+ *
+ * @param a First endpoint
+ * @param b Second endpoint
+ * @return 1 if both match, 0 otherwise
+ */
+int same_ipv4_endpoint(const struct sockaddr_in *a, const struct sockaddr_in *b);
+
+#endif /* ADDR_UTILS_H */
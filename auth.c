@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "auth.h"
+
+static uint64_t read_tag(const unsigned char *p) {
+    uint64_t tag = 0;
+    for (int i = 0; i < AUTH_TAG_SIZE; i++) {
+        tag |= (uint64_t)p[i] << (8 * i);
+    }
+    return tag;
+}
+
+int auth_load_keys(AuthVerifier *auth, const ServerConfig *config) {
+    int result = 0;
+    memset(auth->keys, 0, sizeof(auth->keys));
+    memset(auth->present, 0, sizeof(auth->present));
+    auth->key_count = 0;
+    auth->enabled = config->auth_enabled;
+
+    for (int i = 0; i < config->auth_key_count; i++) {
+        uint8_t key_id;
+        SipKey key;
+        if (auth_parse_key(config->auth_keys[i], &key_id, &key) < 0) {
+            // Only the id is printed; the entry holds the secret
+            fprintf(stderr, "Invalid authentication key entry %d (expected id:32 hex digits)\n", i + 1);
+            result = -1;
+            continue;
+        }
+        if (!auth->present[key_id]) {
+            auth->key_count++;
+        }
+        auth->keys[key_id] = key;
+        auth->present[key_id] = 1;
+    }
+    return result;
+}
+
+int auth_init(AuthVerifier *auth, const ServerConfig *config) {
+    memset(auth, 0, sizeof(AuthVerifier));
+    auth->size = (unsigned int)config->batch_size;
+    auth->results = calloc(auth->size, sizeof(uint8_t));
+    if (!auth->results) {
+        return -1;
+    }
+    return auth_load_keys(auth, config);
+}
+
+void auth_verify_batch(AuthVerifier *auth, const RecvBatch *batch, int count) {
+    // Datagrams with a known key are hashed in groups of SIPHASH_LANES
+    const SipKey *keys[SIPHASH_LANES];
+    const unsigned char *data[SIPHASH_LANES];
+    size_t lens[SIPHASH_LANES];
+    int slots[SIPHASH_LANES];
+    uint64_t tags[SIPHASH_LANES];
+    int lanes = 0;
+
+    for (int i = 0; i < count; i++) {
+        const unsigned char *payload = (const unsigned char *)recv_batch_payload(batch, i);
+        size_t len = batch->msgs[i].msg_len;
+        if (len < AUTH_OVERHEAD) {
+            auth->results[i] = AUTH_MALFORMED;
+            continue;
+        }
+        if (!auth->present[payload[0]]) {
+            auth->results[i] = AUTH_UNKNOWN_KEY;
+            continue;
+        }
+
+        keys[lanes] = &auth->keys[payload[0]];
+        data[lanes] = payload;
+        lens[lanes] = len - AUTH_TAG_SIZE;
+        slots[lanes] = i;
+        if (++lanes < SIPHASH_LANES) {
+            continue;
+        }
+
+        siphash24_x4(keys, data, lens, tags);
+        for (int l = 0; l < SIPHASH_LANES; l++) {
+            auth->results[slots[l]] = tags[l] == read_tag(data[l] + lens[l]) ? AUTH_OK : AUTH_BAD_TAG;
+        }
+        lanes = 0;
+    }
+
+    // Fewer than SIPHASH_LANES left over
+    for (int l = 0; l < lanes; l++) {
+        uint64_t tag = siphash24(keys[l], data[l], lens[l]);
+        auth->results[slots[l]] = tag == read_tag(data[l] + lens[l]) ? AUTH_OK : AUTH_BAD_TAG;
+    }
+}
+
+void auth_free(AuthVerifier *auth) {
+    free(auth->results);
+    auth->results = NULL;
+}
@@ -0,0 +1,69 @@
+#ifndef AUTH_H
+#define AUTH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "udp_server.h"
+#include "batch_io.h"
+#include "siphash.h"
+#include "auth_frame.h"
+
+/**
+ * Verification result of one datagram
+ */
+typedef enum {
+    AUTH_OK = 0,
+    AUTH_MALFORMED,     // shorter than the framing
+    AUTH_UNKNOWN_KEY,   // key id not configured
+    AUTH_BAD_TAG        // tag does not match
+} AuthResult;
+
+/**
+ * Key table and per-batch results of the receive loop
+ */
+typedef struct {
+    int enabled;
+    SipKey keys[AUTH_KEY_IDS];
+    uint8_t present[AUTH_KEY_IDS];
+    int key_count;
+    uint8_t *results;
+    unsigned int size;
+} AuthVerifier;
+
+/**
+ * Allocate the result slots and load the keys of the auth section
+ *
+ * @param auth Verifier to initialize
+ * @param config Server configuration
+ * @return 0 on success, -1 on allocation failure or an invalid key entry
+ */
+int auth_init(AuthVerifier *auth, const ServerConfig *config);
+
+/**
+ * Replace the key table and enable flag with those of a configuration,
+ * e.g. one reloaded for key rotation. Invalid entries are skipped.
+ *
+ * @param auth Verifier
+ * @param config Server configuration
+ * @return 0 on success, -1 if an entry was invalid
+ */
+int auth_load_keys(AuthVerifier *auth, const ServerConfig *config);
+
+/**
+ * Verify every datagram of a received batch, four tags at a time.
+ * Results are stored in auth->results.
+ *
+ * @param auth Verifier
+ * @param batch Received batch
+ * @param count Number of datagrams in the batch
+ */
+void auth_verify_batch(AuthVerifier *auth, const RecvBatch *batch, int count);
+
+/**
+ * Release the result slots
+ *
+ * @param auth Verifier to free
+ */
+void auth_free(AuthVerifier *auth);
+
+#endif /* AUTH_H */
@@ -0,0 +1,32 @@
+#include <stdlib.h>
+#include <string.h>
+#include "auth_frame.h"
+
+int auth_parse_key(const char *spec, uint8_t *key_id, SipKey *key) {
+    char *end;
+    long id = strtol(spec, &end, 10);
+    if (end == spec || *end != ':' || id < 0 || id >= AUTH_KEY_IDS) {
+        return -1;
+    }
+    if (sip_key_from_hex(end + 1, key) < 0) {
+        return -1;
+    }
+    *key_id = (uint8_t)id;
+    return 0;
+}
+
+size_t auth_sign(const SipKey *key, uint8_t key_id, const char *payload, size_t len,
+                 char *out, size_t out_size) {
+    if (len + AUTH_OVERHEAD > out_size) {
+        return 0;
+    }
+    out[0] = (char)key_id;
+    memmove(out + AUTH_KEY_ID_SIZE, payload, len);
+
+    uint64_t tag = siphash24(key, out, len + AUTH_KEY_ID_SIZE);
+    unsigned char *p = (unsigned char *)out + AUTH_KEY_ID_SIZE + len;
+    for (int i = 0; i < AUTH_TAG_SIZE; i++) {
+        p[i] = (unsigned char)(tag >> (8 * i));
+    }
+    return len + AUTH_OVERHEAD;
+}
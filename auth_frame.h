@@ -0,0 +1,39 @@
+#ifndef AUTH_FRAME_H
+#define AUTH_FRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "siphash.h"
+
+// Authenticated frame: [key id][payload][tag], where the tag is the
+// little-endian SipHash-2-4 of the key id byte and the payload
+#define AUTH_KEY_ID_SIZE 1
+#define AUTH_TAG_SIZE 8
+#define AUTH_OVERHEAD (AUTH_KEY_ID_SIZE + AUTH_TAG_SIZE)
+#define AUTH_KEY_IDS 256
+
+/**
+ * Parse a key written as "id:32 hex digits"
+ *
+ * @param spec Key text
+ * @param key_id Parsed key id (0-255)
+ * @param key Parsed key
+ * @return 0 on success, -1 on a malformed entry
+ */
+int auth_parse_key(const char *spec, uint8_t *key_id, SipKey *key);
+
+/**
+ * Build an authenticated frame around a payload
+ *
+ * @param key Key
+ * @param key_id Key id written into the frame
+ * @param payload Payload
+ * @param len Payload length
+ * @param out Frame buffer
+ * @param out_size Size of the frame buffer
+ * @return Frame length, or 0 if the buffer is too small
+ */
+size_t auth_sign(const SipKey *key, uint8_t key_id, const char *payload, size_t len,
+                 char *out, size_t out_size);
+
+#endif /* AUTH_FRAME_H */
@@ -0,0 +1,249 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "batch_io.h"
+
+#ifndef __linux__
+// Fallback for platforms without recvmmsg/sendmmsg: one syscall per datagram
+static int recvmmsg(int sockfd, struct mmsghdr *msgs, unsigned int vlen, int flags, void *timeout) {
+    (void)timeout;
+    unsigned int i;
+    for (i = 0; i < vlen; i++) {
+        ssize_t len = recvmsg(sockfd, &msgs[i].msg_hdr, flags);
+        if (len < 0) {
+            return i > 0 ? (int)i : -1;
+        }
+        msgs[i].msg_len = (unsigned int)len;
+    }
+    return (int)i;
+}
+
+static int sendmmsg(int sockfd, struct mmsghdr *msgs, unsigned int vlen, int flags) {
+    unsigned int i;
+    for (i = 0; i < vlen; i++) {
+        ssize_t len = sendmsg(sockfd, &msgs[i].msg_hdr, flags);
+        if (len < 0) {
+            return i > 0 ? (int)i : -1;
+        }
+        msgs[i].msg_len = (unsigned int)len;
+    }
+    return (int)i;
+}
+#endif
+
+int recv_batch_init(RecvBatch *batch, unsigned int size, size_t buffer_size) {
+    memset(batch, 0, sizeof(*batch));
+    batch->size = size;
+    batch->buffer_size = buffer_size;
+    batch->buffers = malloc((size_t)size * (buffer_size + 1));
+    batch->msgs = calloc(size, sizeof(struct mmsghdr));
+    batch->iovecs = calloc(size, sizeof(struct iovec));
+    batch->addrs = calloc(size, sizeof(struct sockaddr_in));
+    batch->controls = calloc(size, BATCH_CONTROL_SIZE);
+
+    if (!batch->buffers || !batch->msgs || !batch->iovecs || !batch->addrs || !batch->controls) {
+        recv_batch_free(batch);
+        return -1;
+    }
+
+    for (unsigned int i = 0; i < size; i++) {
+        batch->iovecs[i].iov_base = batch->buffers + (size_t)i * (buffer_size + 1);
+        batch->iovecs[i].iov_len = buffer_size;
+        batch->msgs[i].msg_hdr.msg_iov = &batch->iovecs[i];
+        batch->msgs[i].msg_hdr.msg_iovlen = 1;
+        batch->msgs[i].msg_hdr.msg_name = &batch->addrs[i];
+    }
+    return 0;
+}
+
+void recv_batch_free(RecvBatch *batch) {
+    free(batch->buffers);
+    free(batch->msgs);
+    free(batch->iovecs);
+    free(batch->addrs);
+    free(batch->controls);
+    memset(batch, 0, sizeof(*batch));
+}
+
+int recv_batch(int sockfd, RecvBatch *batch) {
+    // The kernel overwrites name/control lengths, so reset them on every call
+    for (unsigned int i = 0; i < batch->size; i++) {
+        struct msghdr *hdr = &batch->msgs[i].msg_hdr;
+        hdr->msg_namelen = sizeof(struct sockaddr_in);
+        hdr->msg_control = batch->controls + (size_t)i * BATCH_CONTROL_SIZE;
+        hdr->msg_controllen = BATCH_CONTROL_SIZE;
+        hdr->msg_flags = 0;
+    }
+
+    int count = recvmmsg(sockfd, batch->msgs, batch->size, MSG_DONTWAIT, NULL);
+    if (count < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return 0;
+        }
+        return -1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        recv_batch_payload(batch, i)[batch->msgs[i].msg_len] = '\0';
+    }
+    return count;
+}
+
+char *recv_batch_payload(const RecvBatch *batch, unsigned int index) {
+    return batch->buffers + (size_t)index * (batch->buffer_size + 1);
+}
+
+int recv_batch_drops(const RecvBatch *batch, unsigned int index, uint32_t *drops) {
+#ifdef SO_RXQ_OVFL
+    struct msghdr *hdr = &batch->msgs[index].msg_hdr;
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(hdr); cmsg; cmsg = CMSG_NXTHDR(hdr, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL) {
+            memcpy(drops, CMSG_DATA(cmsg), sizeof(*drops));
+            return 1;
+        }
+    }
+#else
+    (void)batch;
+    (void)index;
+    (void)drops;
+#endif
+    return 0;
+}
+
+int recv_batch_timestamp(const RecvBatch *batch, unsigned int index, struct timespec *ts) {
+#ifdef SO_TIMESTAMPNS
+    struct msghdr *hdr = &batch->msgs[index].msg_hdr;
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(hdr); cmsg; cmsg = CMSG_NXTHDR(hdr, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+            memcpy(ts, CMSG_DATA(cmsg), sizeof(*ts));
+            return 1;
+        }
+    }
+#else
+    (void)batch;
+    (void)index;
+    (void)ts;
+#endif
+    return 0;
+}
+
+int send_batch(int sockfd, struct mmsghdr *msgs, unsigned int count) {
+    return send_batch_flags(sockfd, msgs, count, 0);
+}
+
+int send_batch_flags(int sockfd, struct mmsghdr *msgs, unsigned int count, int flags) {
+    unsigned int next = 0;
+    int delivered = 0;
+    while (next < count) {
+        int result = sendmmsg(sockfd, msgs + next, count - next, flags);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) {
+                break;
+            }
+            // Skip the datagram that failed so one bad destination does not stall the rest
+            next++;
+            continue;
+        }
+        next += (unsigned int)result;
+        delivered += result;
+    }
+    return delivered;
+}
+
+int recv_batch_reflect(int sockfd, RecvBatch *batch, unsigned int count, uint64_t *bytes_sent) {
+    // Send exactly what arrived; received ancillary data must not go back out as control messages.
+    // msg_len is cleared so afterwards only the datagrams sendmmsg accepted carry a length.
+    for (unsigned int i = 0; i < count; i++) {
+        struct msghdr *hdr = &batch->msgs[i].msg_hdr;
+        batch->iovecs[i].iov_len = batch->msgs[i].msg_len;
+        batch->msgs[i].msg_len = 0;
+        hdr->msg_control = NULL;
+        hdr->msg_controllen = 0;
+        hdr->msg_flags = 0;
+    }
+
+    int sent = send_batch(sockfd, batch->msgs, count);
+
+    uint64_t bytes = 0;
+    for (unsigned int i = 0; i < count; i++) {
+        bytes += batch->msgs[i].msg_len;
+        batch->iovecs[i].iov_len = batch->buffer_size;
+    }
+    if (bytes_sent) {
+        *bytes_sent = bytes;
+    }
+    return sent;
+}
+
+int send_batch_init(SendBatch *batch, unsigned int size, size_t buffer_size) {
+    memset(batch, 0, sizeof(*batch));
+    batch->size = size;
+    batch->buffer_size = buffer_size;
+    batch->buffers = malloc((size_t)size * buffer_size);
+    batch->msgs = calloc(size, sizeof(struct mmsghdr));
+    batch->iovecs = calloc(size, sizeof(struct iovec));
+    batch->addrs = calloc(size, sizeof(struct sockaddr_in));
+
+    if (!batch->buffers || !batch->msgs || !batch->iovecs || !batch->addrs) {
+        send_batch_free(batch);
+        return -1;
+    }
+
+    for (unsigned int i = 0; i < size; i++) {
+        batch->msgs[i].msg_hdr.msg_iov = &batch->iovecs[i];
+        batch->msgs[i].msg_hdr.msg_iovlen = 1;
+        batch->msgs[i].msg_hdr.msg_name = &batch->addrs[i];
+        batch->msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+    }
+    return 0;
+}
+
+void send_batch_free(SendBatch *batch) {
+    free(batch->buffers);
+    free(batch->msgs);
+    free(batch->iovecs);
+    free(batch->addrs);
+    memset(batch, 0, sizeof(*batch));
+}
+
+char *send_batch_next_buffer(SendBatch *batch) {
+    if (batch->count >= batch->size) {
+        return NULL;
+    }
+    return batch->buffers + (size_t)batch->count * batch->buffer_size;
+}
+
+int send_batch_add_ref(SendBatch *batch, const struct sockaddr_in *addr, const void *data, size_t len) {
+    if (batch->count >= batch->size) {
+        return -1;
+    }
+    unsigned int i = batch->count++;
+    batch->addrs[i] = *addr;
+    batch->iovecs[i].iov_base = (void *)data;
+    batch->iovecs[i].iov_len = len;
+    return 0;
+}
+
+int send_batch_add(SendBatch *batch, const struct sockaddr_in *addr, const void *data, size_t len) {
+    char *buffer = send_batch_next_buffer(batch);
+    if (!buffer) {
+        return -1;
+    }
+    if (len > batch->buffer_size) {
+        len = batch->buffer_size;
+    }
+    memcpy(buffer, data, len);
+    return send_batch_add_ref(batch, addr, buffer, len);
+}
+
+int send_batch_flush(int sockfd, SendBatch *batch) {
+    if (batch->count == 0) {
+        return 0;
+    }
+    int sent = send_batch(sockfd, batch->msgs, batch->count);
+    batch->count = 0;
+    return sent;
+}
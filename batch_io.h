@@ -0,0 +1,203 @@
+#ifndef BATCH_IO_H
+#define BATCH_IO_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <time.h>
+
+#ifndef __linux__
+/**
+ * Portable stand-in for the Linux mmsghdr used by recvmmsg/sendmmsg
+ */
+struct mmsghdr {
+    struct msghdr msg_hdr;
+    unsigned int msg_len;
+};
+#endif
+
+// Control buffer space reserved per slot (drop counter + receive timestamp)
+#define BATCH_CONTROL_SIZE 128
+
+/**
+ * A set of receive slots filled by a single recvmmsg call.
+ * Slot i owns buffer i (buffer_size bytes plus a NUL terminator),
+ * the source address and the ancillary data of datagram i.
+ */
+typedef struct {
+    unsigned int size;
+    size_t buffer_size;
+    char *buffers;
+    struct mmsghdr *msgs;
+    struct iovec *iovecs;
+    struct sockaddr_in *addrs;
+    char *controls;
+} RecvBatch;
+
+/**
+ * Outgoing datagrams collected for a single sendmmsg call.
+ * A message either references caller memory or a copy held in slot i.
+ */
+typedef struct {
+    unsigned int size;
+    unsigned int count;
+    size_t buffer_size;
+    char *buffers;
+    struct mmsghdr *msgs;
+    struct iovec *iovecs;
+    struct sockaddr_in *addrs;
+} SendBatch;
+
+/**
+ * Allocate receive slots
+ *
+ * @param batch Batch to initialize
+ * @param size Number of slots
+ * @param buffer_size Maximum payload size per slot
+ * @return 0 on success, -1 on allocation failure
+ */
+int recv_batch_init(RecvBatch *batch, unsigned int size, size_t buffer_size);
+
+/**
+ * Release receive slots
+ *
+ * @param batch Batch to free
+ */
+void recv_batch_free(RecvBatch *batch);
+
+/**
+ * Receive up to batch->size datagrams without blocking.
+ * Each payload is NUL terminated in place.
+ *
+ * @param sockfd Socket file descriptor
+ * @param batch Receive slots
+ * @return Number of datagrams received, 0 if none were pending, -1 on error
+ */
+int recv_batch(int sockfd, RecvBatch *batch);
+
+/**
+ * Get the payload of a received slot
+ *
+ * @param batch Receive slots
+ * @param index Slot index
+ * @return Pointer to the NUL terminated payload
+ */
+char *recv_batch_payload(const RecvBatch *batch, unsigned int index);
+
+/**
+ * Get the kernel drop counter (SO_RXQ_OVFL) carried by a received slot
+ *
+ * @param batch Receive slots
+ * @param index Slot index
+ * @param drops Pointer to store the cumulative drop count
+ * @return 1 if the slot carried a drop counter, 0 otherwise
+ */
+int recv_batch_drops(const RecvBatch *batch, unsigned int index, uint32_t *drops);
+
+/**
+ * Get the kernel receive timestamp (SO_TIMESTAMPNS) of a received slot
+ *
+ * @param batch Receive slots
+ * @param index Slot index
+ * @param ts Pointer to store the CLOCK_REALTIME arrival time
+ * @return 1 if the slot carried a timestamp, 0 otherwise
+ */
+int recv_batch_timestamp(const RecvBatch *batch, unsigned int index, struct timespec *ts);
+
+/**
+ * Send received datagrams back to their sources straight from the receive
+ * slots: each slot's iovec and source address become the outgoing message,
+ * so no payload is copied. The slots can be passed to recv_batch again
+ * afterwards.
+ *
+ * @param sockfd Socket file descriptor
+ * @param batch Receive slots filled by recv_batch
+ * @param count Number of received datagrams to send back
+ * @param bytes_sent Set to the payload bytes of the datagrams actually sent (can be NULL)
+ * @return Number of messages handed to the kernel
+ */
+int recv_batch_reflect(int sockfd, RecvBatch *batch, unsigned int count, uint64_t *bytes_sent);
+
+/**
+ * Send a prepared set of messages, retrying partial sendmmsg results.
+ * A datagram rejected by the kernel is skipped; a full send queue stops the batch.
+ *
+ * @param sockfd Socket file descriptor
+ * @param msgs Messages to send
+ * @param count Number of messages
+ * @return Number of messages handed to the kernel
+ */
+int send_batch(int sockfd, struct mmsghdr *msgs, unsigned int count);
+
+/**
+ * Same as send_batch, with sendmmsg flags; MSG_DONTWAIT turns a full send
+ * queue into an early return even on a blocking socket
+ *
+ * @param sockfd Socket file descriptor
+ * @param msgs Messages to send
+ * @param count Number of messages
+ * @param flags sendmmsg flags
+ * @return Number of messages handed to the kernel
+ */
+int send_batch_flags(int sockfd, struct mmsghdr *msgs, unsigned int count, int flags);
+
+/**
+ * Allocate send slots
+ *
+ * @param batch Batch to initialize
+ * @param size Number of slots
+ * @param buffer_size Size of the copy buffer of each slot
+ * @return 0 on success, -1 on allocation failure
+ */
+int send_batch_init(SendBatch *batch, unsigned int size, size_t buffer_size);
+
+/**
+ * Release send slots
+ *
+ * @param batch Batch to free
+ */
+void send_batch_free(SendBatch *batch);
+
+/**
+ * Get the copy buffer of the next free slot, to build a reply in place
+ *
+ * @param batch Send slots
+ * @return Buffer of batch->buffer_size bytes, or NULL if the batch is full
+ */
+char *send_batch_next_buffer(SendBatch *batch);
+
+/**
+ * Queue a datagram that references caller memory.
+ * The memory must stay valid until the batch is flushed.
+ *
+ * @param batch Send slots
+ * @param addr Destination address
+ * @param data Payload
+ * @param len Payload length
+ * @return 0 on success, -1 if the batch is full
+ */
+int send_batch_add_ref(SendBatch *batch, const struct sockaddr_in *addr, const void *data, size_t len);
+
+/**
+ * Queue a datagram, copying the payload into the slot buffer
+ *
+ * @param batch Send slots
+ * @param addr Destination address
+ * @param data Payload
+ * @param len Payload length (truncated to the slot buffer size)
+ * @return 0 on success, -1 if the batch is full
+ */
+int send_batch_add(SendBatch *batch, const struct sockaddr_in *addr, const void *data, size_t len);
+
+/**
+ * Send all queued datagrams and empty the batch
+ *
+ * @param sockfd Socket file descriptor
+ * @param batch Send slots
+ * @return Number of messages handed to the kernel
+ */
+int send_batch_flush(int sockfd, SendBatch *batch);
+
+#endif /* BATCH_IO_H */
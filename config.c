@@ -0,0 +1,643 @@
+#include "config.h"
+
+// Copy a string value into a fixed-size configuration field
+static void copy_config_string(char *dest, size_t dest_size, const char *value) {
+    strncpy(dest, value, dest_size - 1);
+    dest[dest_size - 1] = '\0';
+}
+
+// Interpret a YAML boolean scalar
+static int parse_bool(const char *value) {
+    return strcmp(value, "true") == 0 ? 1 : 0;
+}
+
+// Function to set default configuration values
+static void set_config_defaults(ServerConfig *config) {
+    memset(config, 0, sizeof(*config));
+
+    strcpy(config->mode, DEFAULT_MODE);
+    config->port = DEFAULT_PORT;
+    config->buffer_size = DEFAULT_BUFFER_SIZE;
+    config->batch_size = DEFAULT_BATCH_SIZE;
+    strcpy(config->response_message, DEFAULT_RESPONSE);
+    strcpy(config->handler, DEFAULT_HANDLER);
+    strcpy(config->log_file, DEFAULT_LOG_FILE);
+    config->logging_enabled = 1;
+
+    // Set default socket options
+    config->reuse_addr = DEFAULT_REUSE_ADDR;
+    config->receive_buffer = DEFAULT_RCVBUF_SIZE;
+    config->send_buffer = DEFAULT_SNDBUF_SIZE;
+    config->broadcast = DEFAULT_BROADCAST;
+    config->ttl = DEFAULT_TTL;
+    config->receive_timeout = DEFAULT_RCVTIMEO;
+
+    // Set default metrics options
+    strcpy(config->metrics_file, DEFAULT_METRICS_FILE);
+    config->metrics_interval = DEFAULT_METRICS_INTERVAL;
+
+    // Set default overload protection options
+    config->overload_enabled = 0;
+    config->overload_interval_ms = DEFAULT_OVERLOAD_INTERVAL_MS;
+    config->overload_hold_ms = DEFAULT_OVERLOAD_HOLD_MS;
+    config->overload_drop_threshold = DEFAULT_OVERLOAD_DROP_THRESHOLD;
+    config->overload_delay_threshold_us = DEFAULT_OVERLOAD_DELAY_THRESHOLD_US;
+    config->overload_fill_threshold = DEFAULT_OVERLOAD_FILL_THRESHOLD;
+    config->overload_hysteresis = DEFAULT_OVERLOAD_HYSTERESIS;
+    strcpy(config->busy_message, DEFAULT_BUSY_RESPONSE);
+
+    // Set default deferred request options
+    config->max_pending = DEFAULT_MAX_PENDING;
+    config->async_timeout_ms = DEFAULT_ASYNC_TIMEOUT_MS;
+    config->async_threads = DEFAULT_ASYNC_THREADS;
+    strcpy(config->fallback_message, DEFAULT_FALLBACK_RESPONSE);
+
+    // Set default proxy options
+    strcpy(config->proxy_balance, DEFAULT_PROXY_BALANCE);
+    config->proxy_max_flows = DEFAULT_PROXY_MAX_FLOWS;
+    config->proxy_idle_timeout_ms = DEFAULT_PROXY_IDLE_TIMEOUT_MS;
+    config->proxy_health_interval_ms = DEFAULT_PROXY_HEALTH_INTERVAL_MS;
+    config->proxy_health_timeout_ms = DEFAULT_PROXY_HEALTH_TIMEOUT_MS;
+    config->proxy_health_fail_threshold = DEFAULT_PROXY_HEALTH_FAIL_THRESHOLD;
+    strcpy(config->proxy_health_payload, DEFAULT_PROXY_HEALTH_PAYLOAD);
+
+    // Set default echo mode options
+    strcpy(config->echo_stamp, DEFAULT_ECHO_STAMP);
+    config->echo_stamp_offset = DEFAULT_ECHO_STAMP_OFFSET;
+
+    // Set default pub/sub options
+    config->pubsub_lease_seconds = DEFAULT_PUBSUB_LEASE_SECONDS;
+    config->pubsub_max_topics = DEFAULT_PUBSUB_MAX_TOPICS;
+    config->pubsub_max_subscriptions = DEFAULT_PUBSUB_MAX_SUBSCRIPTIONS;
+    config->pubsub_fanout_batch = DEFAULT_PUBSUB_FANOUT_BATCH;
+
+    // Set default key-value store options
+    config->kv_memory_mb = DEFAULT_KV_MEMORY_MB;
+    config->kv_shards = DEFAULT_KV_SHARDS;
+
+    // No payload filters by default
+    config->filter_rule_count = 0;
+    config->filter_route_to[0] = '\0';
+
+    // Authentication is off by default
+    config->auth_enabled = 0;
+    config->auth_key_count = 0;
+
+    // Set default StatsD ingestion options
+    config->statsd_flush_interval = DEFAULT_STATSD_FLUSH_INTERVAL;
+    strcpy(config->statsd_output_file, DEFAULT_STATSD_OUTPUT_FILE);
+    config->statsd_max_metrics = DEFAULT_STATSD_MAX_METRICS;
+
+    // Set default syslog sink options
+    strcpy(config->syslog_directory, DEFAULT_SYSLOG_DIRECTORY);
+    strcpy(config->syslog_prefix, DEFAULT_SYSLOG_PREFIX);
+    config->syslog_buffer_kb = DEFAULT_SYSLOG_BUFFER_KB;
+    config->syslog_buffer_count = DEFAULT_SYSLOG_BUFFER_COUNT;
+    config->syslog_flush_interval_ms = DEFAULT_SYSLOG_FLUSH_INTERVAL_MS;
+    config->syslog_segment_mb = DEFAULT_SYSLOG_SEGMENT_MB;
+    config->syslog_segment_seconds = DEFAULT_SYSLOG_SEGMENT_SECONDS;
+    strcpy(config->syslog_fsync, DEFAULT_SYSLOG_FSYNC);
+    config->syslog_direct_io = 0;
+
+    // Set default tracing options
+    config->trace_enabled = 0;
+    config->trace_sample_every = DEFAULT_TRACE_SAMPLE_EVERY;
+    config->trace_ring_size = DEFAULT_TRACE_RING_SIZE;
+    strcpy(config->trace_output_file, DEFAULT_TRACE_OUTPUT_FILE);
+}
+
+// Function to apply a single "section.key: value" setting
+static void apply_config_value(ServerConfig *config, const char *section,
+                               const char *key, const char *value) {
+    if (strcmp(section, "server") == 0) {
+        if (strcmp(key, "mode") == 0) {
+            copy_config_string(config->mode, sizeof(config->mode), value);
+        } else if (strcmp(key, "port") == 0) {
+            config->port = atoi(value);
+        } else if (strcmp(key, "buffer_size") == 0) {
+            config->buffer_size = atoi(value);
+        } else if (strcmp(key, "batch_size") == 0) {
+            config->batch_size = atoi(value);
+        } else if (strcmp(key, "response_message") == 0) {
+            copy_config_string(config->response_message, sizeof(config->response_message), value);
+        } else if (strcmp(key, "handler") == 0) {
+            copy_config_string(config->handler, sizeof(config->handler), value);
+        }
+    } else if (strcmp(section, "logging") == 0) {
+        if (strcmp(key, "file") == 0) {
+            copy_config_string(config->log_file, sizeof(config->log_file), value);
+        } else if (strcmp(key, "enable") == 0) {
+            config->logging_enabled = parse_bool(value);
+        }
+    } else if (strcmp(section, "socket_options") == 0) {
+        if (strcmp(key, "reuse_addr") == 0) {
+            config->reuse_addr = parse_bool(value);
+        } else if (strcmp(key, "receive_buffer") == 0) {
+            config->receive_buffer = atoi(value);
+        } else if (strcmp(key, "send_buffer") == 0) {
+            config->send_buffer = atoi(value);
+        } else if (strcmp(key, "broadcast") == 0) {
+            config->broadcast = parse_bool(value);
+        } else if (strcmp(key, "ttl") == 0) {
+            config->ttl = atoi(value);
+        } else if (strcmp(key, "receive_timeout") == 0) {
+            config->receive_timeout = atoi(value);
+        }
+    } else if (strcmp(section, "metrics") == 0) {
+        if (strcmp(key, "file") == 0) {
+            copy_config_string(config->metrics_file, sizeof(config->metrics_file), value);
+        } else if (strcmp(key, "interval") == 0) {
+            config->metrics_interval = atoi(value);
+        }
+    } else if (strcmp(section, "overload") == 0) {
+        if (strcmp(key, "enable") == 0) {
+            config->overload_enabled = parse_bool(value);
+        } else if (strcmp(key, "interval_ms") == 0) {
+            config->overload_interval_ms = atoi(value);
+        } else if (strcmp(key, "hold_ms") == 0) {
+            config->overload_hold_ms = atoi(value);
+        } else if (strcmp(key, "drop_threshold") == 0) {
+            config->overload_drop_threshold = atof(value);
+        } else if (strcmp(key, "delay_threshold_us") == 0) {
+            config->overload_delay_threshold_us = atof(value);
+        } else if (strcmp(key, "fill_threshold") == 0) {
+            config->overload_fill_threshold = atof(value);
+        } else if (strcmp(key, "hysteresis") == 0) {
+            config->overload_hysteresis = atof(value);
+        } else if (strcmp(key, "busy_message") == 0) {
+            copy_config_string(config->busy_message, sizeof(config->busy_message), value);
+        }
+    } else if (strcmp(section, "async") == 0) {
+        if (strcmp(key, "max_pending") == 0) {
+            config->max_pending = atoi(value);
+        } else if (strcmp(key, "timeout_ms") == 0) {
+            config->async_timeout_ms = atoi(value);
+        } else if (strcmp(key, "threads") == 0) {
+            config->async_threads = atoi(value);
+        } else if (strcmp(key, "fallback_message") == 0) {
+            copy_config_string(config->fallback_message, sizeof(config->fallback_message), value);
+        }
+    } else if (strcmp(section, "proxy") == 0) {
+        if (strcmp(key, "balance") == 0) {
+            copy_config_string(config->proxy_balance, sizeof(config->proxy_balance), value);
+        } else if (strcmp(key, "max_flows") == 0) {
+            config->proxy_max_flows = atoi(value);
+        } else if (strcmp(key, "idle_timeout_ms") == 0) {
+            config->proxy_idle_timeout_ms = atoi(value);
+        } else if (strcmp(key, "health_interval_ms") == 0) {
+            config->proxy_health_interval_ms = atoi(value);
+        } else if (strcmp(key, "health_timeout_ms") == 0) {
+            config->proxy_health_timeout_ms = atoi(value);
+        } else if (strcmp(key, "health_fail_threshold") == 0) {
+            config->proxy_health_fail_threshold = atoi(value);
+        } else if (strcmp(key, "health_payload") == 0) {
+            copy_config_string(config->proxy_health_payload, sizeof(config->proxy_health_payload), value);
+        }
+    } else if (strcmp(section, "echo") == 0) {
+        if (strcmp(key, "stamp") == 0) {
+            copy_config_string(config->echo_stamp, sizeof(config->echo_stamp), value);
+        } else if (strcmp(key, "stamp_offset") == 0) {
+            config->echo_stamp_offset = atoi(value);
+        }
+    } else if (strcmp(section, "pubsub") == 0) {
+        if (strcmp(key, "lease_seconds") == 0) {
+            config->pubsub_lease_seconds = atoi(value);
+        } else if (strcmp(key, "max_topics") == 0) {
+            config->pubsub_max_topics = atoi(value);
+        } else if (strcmp(key, "max_subscriptions") == 0) {
+            config->pubsub_max_subscriptions = atoi(value);
+        } else if (strcmp(key, "fanout_batch") == 0) {
+            config->pubsub_fanout_batch = atoi(value);
+        }
+    } else if (strcmp(section, "kv") == 0) {
+        if (strcmp(key, "memory_mb") == 0) {
+            config->kv_memory_mb = atoi(value);
+        } else if (strcmp(key, "shards") == 0) {
+            config->kv_shards = atoi(value);
+        }
+    } else if (strcmp(section, "filters") == 0) {
+        if (strcmp(key, "route_to") == 0) {
+            copy_config_string(config->filter_route_to, sizeof(config->filter_route_to), value);
+        }
+    } else if (strcmp(section, "auth") == 0) {
+        if (strcmp(key, "enable") == 0) {
+            config->auth_enabled = parse_bool(value);
+        }
+    } else if (strcmp(section, "statsd") == 0) {
+        if (strcmp(key, "flush_interval") == 0) {
+            config->statsd_flush_interval = atoi(value);
+        } else if (strcmp(key, "output_file") == 0) {
+            copy_config_string(config->statsd_output_file, sizeof(config->statsd_output_file), value);
+        } else if (strcmp(key, "max_metrics") == 0) {
+            config->statsd_max_metrics = atoi(value);
+        }
+    } else if (strcmp(section, "syslog") == 0) {
+        if (strcmp(key, "directory") == 0) {
+            copy_config_string(config->syslog_directory, sizeof(config->syslog_directory), value);
+        } else if (strcmp(key, "prefix") == 0) {
+            copy_config_string(config->syslog_prefix, sizeof(config->syslog_prefix), value);
+        } else if (strcmp(key, "buffer_kb") == 0) {
+            config->syslog_buffer_kb = atoi(value);
+        } else if (strcmp(key, "buffer_count") == 0) {
+            config->syslog_buffer_count = atoi(value);
+        } else if (strcmp(key, "flush_interval_ms") == 0) {
+            config->syslog_flush_interval_ms = atoi(value);
+        } else if (strcmp(key, "segment_mb") == 0) {
+            config->syslog_segment_mb = atoi(value);
+        } else if (strcmp(key, "segment_seconds") == 0) {
+            config->syslog_segment_seconds = atoi(value);
+        } else if (strcmp(key, "fsync") == 0) {
+            copy_config_string(config->syslog_fsync, sizeof(config->syslog_fsync), value);
+        } else if (strcmp(key, "direct_io") == 0) {
+            config->syslog_direct_io = parse_bool(value);
+        }
+    } else if (strcmp(section, "tracing") == 0) {
+        if (strcmp(key, "enable") == 0) {
+            config->trace_enabled = parse_bool(value);
+        } else if (strcmp(key, "sample_every") == 0) {
+            config->trace_sample_every = atoi(value);
+        } else if (strcmp(key, "ring_size") == 0) {
+            config->trace_ring_size = atoi(value);
+        } else if (strcmp(key, "output_file") == 0) {
+            copy_config_string(config->trace_output_file, sizeof(config->trace_output_file), value);
+        }
+    }
+}
+
+// Function to append one item of a "section.key: [ ... ]" list
+static void apply_config_list_item(ServerConfig *config, const char *section,
+                                   const char *key, const char *value) {
+    if (strcmp(section, "overload") == 0) {
+        if (strcmp(key, "low_priority_clients") == 0 &&
+            config->low_priority_client_count < MAX_PRIORITY_RULES) {
+            copy_config_string(config->low_priority_clients[config->low_priority_client_count++],
+                               MAX_RULE_LENGTH, value);
+        } else if (strcmp(key, "low_priority_prefixes") == 0 &&
+                   config->low_priority_prefix_count < MAX_PRIORITY_RULES) {
+            copy_config_string(config->low_priority_prefixes[config->low_priority_prefix_count++],
+                               MAX_RULE_LENGTH, value);
+        }
+    } else if (strcmp(section, "proxy") == 0) {
+        if (strcmp(key, "backends") == 0 && config->proxy_backend_count < MAX_PROXY_BACKENDS) {
+            copy_config_string(config->proxy_backends[config->proxy_backend_count++],
+                               MAX_RULE_LENGTH, value);
+        }
+    } else if (strcmp(section, "filters") == 0) {
+        if (strcmp(key, "rules") == 0 && config->filter_rule_count < MAX_FILTER_RULES) {
+            copy_config_string(config->filter_rules[config->filter_rule_count++],
+                               MAX_RULE_LENGTH, value);
+        }
+    } else if (strcmp(section, "auth") == 0) {
+        if (strcmp(key, "keys") == 0 && config->auth_key_count < MAX_AUTH_KEYS) {
+            copy_config_string(config->auth_keys[config->auth_key_count++], MAX_RULE_LENGTH, value);
+        }
+    }
+}
+
+// Function to load configuration from YAML file
+ServerConfig load_config(const char *config_file) {
+    ServerConfig config;
+    read_config(config_file, &config);
+    return config;
+}
+
+// Function to read configuration from YAML file, reporting whether the whole file was read
+int read_config(const char *config_file, ServerConfig *config) {
+    set_config_defaults(config);
+
+    FILE *fh = fopen(config_file, "r");
+    if (!fh) {
+        fprintf(stderr, "Cannot open configuration file %s. Using default settings.\n", config_file);
+        return -1;
+    }
+
+    yaml_parser_t parser;
+    yaml_event_t event;
+
+    // Initialize parser
+    if (!yaml_parser_initialize(&parser)) {
+        fprintf(stderr, "Failed to initialize YAML parser.\n");
+        fclose(fh);
+        return -1;
+    }
+
+    yaml_parser_set_input_file(&parser, fh);
+
+    // Sections are top-level keys (depth 1); settings live one mapping below
+    char section[256] = {0};
+    char key[256] = {0};
+    int depth = 0;
+    int in_sequence = 0;
+    int done = 0;
+    int result = 0;
+
+    while (!done) {
+        if (!yaml_parser_parse(&parser, &event)) {
+            fprintf(stderr, "Parse error in %s at line %lu: %s\n", config_file,
+                    (unsigned long)parser.problem_mark.line + 1,
+                    parser.problem ? parser.problem : "unknown error");
+            result = -1;
+            break;
+        }
+
+        switch(event.type) {
+            case YAML_SCALAR_EVENT: {
+                const char *value = (const char *)event.data.scalar.value;
+                if (depth == 1) {
+                    copy_config_string(section, sizeof(section), value);
+                } else if (depth == 2 && in_sequence) {
+                    apply_config_list_item(config, section, key, value);
+                } else if (depth == 2 && key[0] == '\0') {
+                    copy_config_string(key, sizeof(key), value);
+                } else if (depth == 2) {
+                    apply_config_value(config, section, key, value);
+                    key[0] = '\0';
+                }
+                break;
+            }
+            case YAML_MAPPING_START_EVENT:
+                depth++;
+                break;
+            case YAML_MAPPING_END_EVENT:
+                depth--;
+                if (depth <= 1) {
+                    section[0] = '\0';
+                    key[0] = '\0';
+                }
+                break;
+            case YAML_SEQUENCE_START_EVENT:
+                in_sequence = 1;
+                break;
+            case YAML_SEQUENCE_END_EVENT:
+                in_sequence = 0;
+                key[0] = '\0';
+                break;
+            case YAML_STREAM_END_EVENT:
+                done = 1;
+                break;
+            default:
+                break;
+        }
+
+        yaml_event_delete(&event);
+    }
+
+    yaml_parser_delete(&parser);
+    fclose(fh);
+
+    validate_config(config);
+    print_config(config);
+
+    return result;
+}
+
+// Function to print the effective configuration
+void print_config(const ServerConfig *config) {
+    printf("Mode: %s\n", config->mode);
+    printf("Configuration loaded: Port=%d, Buffer size=%d, Batch size=%d, Handler=%s, Response message=%s\n",
+           config->port, config->buffer_size, config->batch_size, config->handler, config->response_message);
+    printf("Log settings: File=%s, Enabled=%s\n",
+           config->log_file, config->logging_enabled ? "yes" : "no");
+    printf("Socket options: REUSEADDR=%s, RCVBUF=%d, SNDBUF=%d, BROADCAST=%s, TTL=%d, RCVTIMEO=%d\n",
+           config->reuse_addr ? "yes" : "no",
+           config->receive_buffer,
+           config->send_buffer,
+           config->broadcast ? "yes" : "no",
+           config->ttl,
+           config->receive_timeout);
+    if (config->metrics_interval > 0) {
+        printf("Metrics: File=%s, Interval=%ds\n", config->metrics_file, config->metrics_interval);
+    }
+    if (config->overload_enabled) {
+        printf("Overload protection: Interval=%dms, Hold=%dms, Drops>=%.0f, Delay>=%.0fus, Fill>=%.2f, Hysteresis=%.2f\n",
+               config->overload_interval_ms,
+               config->overload_hold_ms,
+               config->overload_drop_threshold,
+               config->overload_delay_threshold_us,
+               config->overload_fill_threshold,
+               config->overload_hysteresis);
+        printf("Overload low priority rules: %d clients, %d prefixes\n",
+               config->low_priority_client_count, config->low_priority_prefix_count);
+    }
+    if (config->filter_rule_count > 0) {
+        printf("Payload filters: %d rules, Route to=%s\n", config->filter_rule_count,
+               config->filter_route_to[0] ? config->filter_route_to : "none");
+    }
+    if (config->auth_enabled) {
+        printf("Authentication: SipHash-2-4, Keys=%d\n", config->auth_key_count);
+    }
+    if (config->trace_enabled) {
+        printf("Tracing: Sample every=%d, Ring size=%d spans, Output=%s\n",
+               config->trace_sample_every, config->trace_ring_size, config->trace_output_file);
+    }
+    printf("Deferred requests: Max pending=%d, Timeout=%dms, Threads=%d\n",
+           config->max_pending, config->async_timeout_ms, config->async_threads);
+    if (strcmp(config->mode, "proxy") == 0) {
+        printf("Proxy: Backends=%d, Balance=%s, Max flows=%d, Idle timeout=%dms, Health interval=%dms\n",
+               config->proxy_backend_count, config->proxy_balance, config->proxy_max_flows,
+               config->proxy_idle_timeout_ms, config->proxy_health_interval_ms);
+    }
+    if (strcmp(config->mode, "echo") == 0) {
+        printf("Echo: Stamp=%s, Stamp offset=%d\n", config->echo_stamp, config->echo_stamp_offset);
+    }
+    if (strcmp(config->handler, "pubsub") == 0) {
+        printf("Pub/sub: Lease=%ds, Max topics=%d, Max subscriptions=%d, Fan-out batch=%d\n",
+               config->pubsub_lease_seconds, config->pubsub_max_topics,
+               config->pubsub_max_subscriptions, config->pubsub_fanout_batch);
+    }
+    if (strcmp(config->handler, "kv") == 0) {
+        printf("Key-value store: Memory=%dMB, Shards=%d\n", config->kv_memory_mb, config->kv_shards);
+    }
+    if (strcmp(config->handler, "statsd") == 0) {
+        printf("StatsD: Flush interval=%ds, Output=%s, Max metrics=%d\n",
+               config->statsd_flush_interval, config->statsd_output_file, config->statsd_max_metrics);
+    }
+    if (strcmp(config->handler, "syslog") == 0) {
+        printf("Syslog sink: Directory=%s, Buffers=%dx%dKB, Flush=%dms, Segment=%dMB/%ds, Fsync=%s, Direct I/O=%s\n",
+               config->syslog_directory, config->syslog_buffer_count, config->syslog_buffer_kb,
+               config->syslog_flush_interval_ms, config->syslog_segment_mb, config->syslog_segment_seconds,
+               config->syslog_fsync, config->syslog_direct_io ? "yes" : "no");
+    }
+}
+
+// Function to validate configuration values, falling back to defaults
+int validate_config(ServerConfig *config) {
+    int result = 0;
+
+    if (config->port <= 0 || config->port > 65535) {
+        fprintf(stderr, "Invalid port %d. Using default %d.\n", config->port, DEFAULT_PORT);
+        config->port = DEFAULT_PORT;
+        result = -1;
+    }
+    if (config->buffer_size <= 0) {
+        fprintf(stderr, "Invalid buffer_size %d. Using default %d.\n", config->buffer_size, DEFAULT_BUFFER_SIZE);
+        config->buffer_size = DEFAULT_BUFFER_SIZE;
+        result = -1;
+    }
+    if (config->batch_size <= 0 || config->batch_size > MAX_BATCH_SIZE) {
+        fprintf(stderr, "Invalid batch_size %d. Using default %d.\n", config->batch_size, DEFAULT_BATCH_SIZE);
+        config->batch_size = DEFAULT_BATCH_SIZE;
+        result = -1;
+    }
+    if (config->metrics_interval < 0) {
+        config->metrics_interval = 0;
+        result = -1;
+    }
+    if (config->overload_interval_ms <= 0) {
+        config->overload_interval_ms = DEFAULT_OVERLOAD_INTERVAL_MS;
+        result = -1;
+    }
+    if (config->overload_hold_ms < 0) {
+        config->overload_hold_ms = DEFAULT_OVERLOAD_HOLD_MS;
+        result = -1;
+    }
+    if (config->overload_hysteresis <= 0.0 || config->overload_hysteresis >= 1.0) {
+        fprintf(stderr, "Invalid overload hysteresis %.2f. Using default %.2f.\n",
+                config->overload_hysteresis, DEFAULT_OVERLOAD_HYSTERESIS);
+        config->overload_hysteresis = DEFAULT_OVERLOAD_HYSTERESIS;
+        result = -1;
+    }
+
+    if (config->max_pending <= 0) {
+        fprintf(stderr, "Invalid max_pending %d. Using default %d.\n", config->max_pending, DEFAULT_MAX_PENDING);
+        config->max_pending = DEFAULT_MAX_PENDING;
+        result = -1;
+    }
+    if (config->async_timeout_ms <= 0) {
+        config->async_timeout_ms = DEFAULT_ASYNC_TIMEOUT_MS;
+        result = -1;
+    }
+    if (config->async_threads <= 0) {
+        config->async_threads = DEFAULT_ASYNC_THREADS;
+        result = -1;
+    }
+    if (strcmp(config->mode, "server") != 0 && strcmp(config->mode, "proxy") != 0 &&
+        strcmp(config->mode, "echo") != 0) {
+        fprintf(stderr, "Unknown mode %s. Using %s.\n", config->mode, DEFAULT_MODE);
+        strcpy(config->mode, DEFAULT_MODE);
+        result = -1;
+    }
+    if (strcmp(config->proxy_balance, "consistent_hash") != 0 &&
+        strcmp(config->proxy_balance, "least_outstanding") != 0) {
+        fprintf(stderr, "Unknown proxy balance %s. Using %s.\n", config->proxy_balance, DEFAULT_PROXY_BALANCE);
+        strcpy(config->proxy_balance, DEFAULT_PROXY_BALANCE);
+        result = -1;
+    }
+    if (config->proxy_max_flows <= 0) {
+        config->proxy_max_flows = DEFAULT_PROXY_MAX_FLOWS;
+        result = -1;
+    }
+    if (config->proxy_idle_timeout_ms <= 0) {
+        config->proxy_idle_timeout_ms = DEFAULT_PROXY_IDLE_TIMEOUT_MS;
+        result = -1;
+    }
+    if (config->proxy_health_interval_ms > 0 &&
+        (config->proxy_health_timeout_ms <= 0 ||
+         config->proxy_health_timeout_ms >= config->proxy_health_interval_ms)) {
+        fprintf(stderr, "Invalid proxy health_timeout_ms %d. Using default %d.\n",
+                config->proxy_health_timeout_ms, DEFAULT_PROXY_HEALTH_TIMEOUT_MS);
+        config->proxy_health_timeout_ms = DEFAULT_PROXY_HEALTH_TIMEOUT_MS;
+        // A probe must time out before the next one is sent
+        if (config->proxy_health_timeout_ms >= config->proxy_health_interval_ms) {
+            config->proxy_health_timeout_ms = config->proxy_health_interval_ms / 2;
+        }
+        result = -1;
+    }
+    if (config->proxy_health_fail_threshold <= 0) {
+        config->proxy_health_fail_threshold = DEFAULT_PROXY_HEALTH_FAIL_THRESHOLD;
+        result = -1;
+    }
+    if (strcmp(config->echo_stamp, "none") != 0 && strcmp(config->echo_stamp, "timestamp") != 0 &&
+        strcmp(config->echo_stamp, "sequence") != 0) {
+        fprintf(stderr, "Unknown echo stamp %s. Using %s.\n", config->echo_stamp, DEFAULT_ECHO_STAMP);
+        strcpy(config->echo_stamp, DEFAULT_ECHO_STAMP);
+        result = -1;
+    }
+    if (config->echo_stamp_offset < 0 || config->echo_stamp_offset + ECHO_STAMP_SIZE > config->buffer_size) {
+        fprintf(stderr, "Invalid echo stamp_offset %d. Using default %d.\n",
+                config->echo_stamp_offset, DEFAULT_ECHO_STAMP_OFFSET);
+        config->echo_stamp_offset = DEFAULT_ECHO_STAMP_OFFSET;
+        result = -1;
+    }
+    if (config->pubsub_lease_seconds <= 0) {
+        config->pubsub_lease_seconds = DEFAULT_PUBSUB_LEASE_SECONDS;
+        result = -1;
+    }
+    if (config->pubsub_max_topics <= 0) {
+        config->pubsub_max_topics = DEFAULT_PUBSUB_MAX_TOPICS;
+        result = -1;
+    }
+    if (config->pubsub_max_subscriptions <= 0) {
+        config->pubsub_max_subscriptions = DEFAULT_PUBSUB_MAX_SUBSCRIPTIONS;
+        result = -1;
+    }
+    if (config->pubsub_fanout_batch <= 0 || config->pubsub_fanout_batch > MAX_BATCH_SIZE) {
+        fprintf(stderr, "Invalid pubsub fanout_batch %d. Using default %d.\n",
+                config->pubsub_fanout_batch, DEFAULT_PUBSUB_FANOUT_BATCH);
+        config->pubsub_fanout_batch = DEFAULT_PUBSUB_FANOUT_BATCH;
+        result = -1;
+    }
+    if (config->kv_memory_mb <= 0) {
+        config->kv_memory_mb = DEFAULT_KV_MEMORY_MB;
+        result = -1;
+    }
+    if (config->kv_shards <= 0 || config->kv_shards > MAX_KV_SHARDS) {
+        fprintf(stderr, "Invalid kv shards %d. Using default %d.\n", config->kv_shards, DEFAULT_KV_SHARDS);
+        config->kv_shards = DEFAULT_KV_SHARDS;
+        result = -1;
+    }
+    if (config->statsd_flush_interval <= 0) {
+        config->statsd_flush_interval = DEFAULT_STATSD_FLUSH_INTERVAL;
+        result = -1;
+    }
+    if (config->statsd_max_metrics <= 0) {
+        config->statsd_max_metrics = DEFAULT_STATSD_MAX_METRICS;
+        result = -1;
+    }
+    if (config->syslog_buffer_kb < MIN_SYSLOG_BUFFER_KB) {
+        fprintf(stderr, "Invalid syslog buffer_kb %d. Using minimum %d.\n",
+                config->syslog_buffer_kb, MIN_SYSLOG_BUFFER_KB);
+        config->syslog_buffer_kb = MIN_SYSLOG_BUFFER_KB;
+        result = -1;
+    }
+    if (config->syslog_buffer_count < 2) {
+        config->syslog_buffer_count = DEFAULT_SYSLOG_BUFFER_COUNT;
+        result = -1;
+    }
+    if (config->syslog_flush_interval_ms <= 0) {
+        config->syslog_flush_interval_ms = DEFAULT_SYSLOG_FLUSH_INTERVAL_MS;
+        result = -1;
+    }
+    if (config->syslog_segment_mb <= 0) {
+        config->syslog_segment_mb = DEFAULT_SYSLOG_SEGMENT_MB;
+        result = -1;
+    }
+    if (config->syslog_segment_seconds < 0) {
+        config->syslog_segment_seconds = 0;
+        result = -1;
+    }
+    if (strcmp(config->syslog_fsync, "none") != 0 && strcmp(config->syslog_fsync, "segment") != 0 &&
+        strcmp(config->syslog_fsync, "always") != 0) {
+        fprintf(stderr, "Unknown syslog fsync policy %s. Using %s.\n", config->syslog_fsync, DEFAULT_SYSLOG_FSYNC);
+        strcpy(config->syslog_fsync, DEFAULT_SYSLOG_FSYNC);
+        result = -1;
+    }
+    // Only the server loop records spans and installs the SIGUSR1 handler that writes them
+    if (config->trace_enabled && strcmp(config->mode, "server") != 0) {
+        fprintf(stderr, "Tracing applies in server mode only. Disabling it in %s mode.\n", config->mode);
+        config->trace_enabled = 0;
+        result = -1;
+    }
+    if (config->trace_sample_every <= 0) {
+        config->trace_sample_every = DEFAULT_TRACE_SAMPLE_EVERY;
+        result = -1;
+    }
+    if (config->trace_ring_size < MIN_TRACE_RING_SIZE) {
+        fprintf(stderr, "Invalid trace ring_size %d. Using minimum %d.\n",
+                config->trace_ring_size, MIN_TRACE_RING_SIZE);
+        config->trace_ring_size = MIN_TRACE_RING_SIZE;
+        result = -1;
+    }
+
+    return result;
+}
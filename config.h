@@ -13,6 +13,17 @@
  */
 ServerConfig load_config(const char *config_file);
 
+/**
+ * Load server configuration from YAML file and report whether it was read
+ * completely. A missing file leaves the defaults; a YAML error leaves the
+ * settings read before it.
+ *
+ * @param config_file Path to the configuration file
+ * @param config Configuration to fill in
+ * @return 0 on success, -1 if the file could not be opened or parsed
+ */
+int read_config(const char *config_file, ServerConfig *config);
+
 /**
  * Print current configuration to stdout
  *
@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include "echo.h"
+
+// Upper bound of recvmmsg calls per wakeup, so metrics still get written under load
+#define ECHO_MAX_DRAIN 64
+// poll timeout; bounds the latency of metrics snapshots when idle
+#define ECHO_TICK_MS 100
+
+static const char *stamp_names[] = { "none", "timestamp", "sequence" };
+
+static uint64_t realtime_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Overwrite ECHO_STAMP_SIZE bytes at the stamp offset, big-endian, in the receive buffer itself
+static void stamp_batch(EchoServer *echo, int count) {
+    RecvBatch *batch = &echo->batch;
+    // Without SO_TIMESTAMPNS data the whole batch shares one clock reading
+    uint64_t batch_ns = echo->stamp == ECHO_STAMP_TIMESTAMP ? realtime_ns() : 0;
+
+    for (int i = 0; i < count; i++) {
+        if (batch->msgs[i].msg_len < echo->stamp_offset + ECHO_STAMP_SIZE) {
+            echo->metrics.echo_too_short++;
+            continue;
+        }
+
+        uint64_t value;
+        struct timespec ts;
+        if (echo->stamp == ECHO_STAMP_SEQUENCE) {
+            value = echo->sequence++;
+        } else if (recv_batch_timestamp(batch, i, &ts)) {
+            value = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+        } else {
+            value = batch_ns;
+        }
+
+        unsigned char *p = (unsigned char *)recv_batch_payload(batch, i) + echo->stamp_offset;
+        for (int b = 0; b < ECHO_STAMP_SIZE; b++) {
+            p[b] = (unsigned char)(value >> (8 * (ECHO_STAMP_SIZE - 1 - b)));
+        }
+        echo->metrics.echo_stamped++;
+    }
+}
+
+static void echo_batch(EchoServer *echo, int count) {
+    RecvBatch *batch = &echo->batch;
+    ServerMetrics *metrics = &echo->metrics;
+
+    if (echo->stamp != ECHO_STAMP_NONE) {
+        stamp_batch(echo, count);
+    }
+
+    uint64_t bytes = 0;
+    for (int i = 0; i < count; i++) {
+        bytes += batch->msgs[i].msg_len;
+    }
+
+    uint64_t bytes_sent;
+    int sent = recv_batch_reflect(echo->listen_fd, batch, count, &bytes_sent);
+    metrics->batches++;
+    metrics->packets_received += count;
+    metrics->bytes_received += bytes;
+    metrics->packets_sent += sent;
+    metrics->send_errors += count - sent;
+    metrics->bytes_sent += bytes_sent;
+}
+
+static void write_echo_metrics(EchoServer *echo) {
+    if (write_metrics(&echo->metrics, echo->config->metrics_file) < 0 && echo->log_fp) {
+        write_json_log(echo->log_fp, "error", "Failed to write metrics", NULL, 0);
+    }
+}
+
+int echo_init(EchoServer *echo, const ServerConfig *config, int listen_fd, FILE *log_fp) {
+    memset(echo, 0, sizeof(*echo));
+    echo->config = config;
+    echo->log_fp = log_fp;
+    echo->listen_fd = listen_fd;
+    echo->stamp_offset = (size_t)config->echo_stamp_offset;
+
+    if (strcmp(config->echo_stamp, "timestamp") == 0) {
+        echo->stamp = ECHO_STAMP_TIMESTAMP;
+    } else if (strcmp(config->echo_stamp, "sequence") == 0) {
+        echo->stamp = ECHO_STAMP_SEQUENCE;
+    } else {
+        echo->stamp = ECHO_STAMP_NONE;
+    }
+
+    if (recv_batch_init(&echo->batch, config->batch_size, config->buffer_size) < 0) {
+        perror("Memory allocation failed");
+        return -1;
+    }
+
+    echo->metrics.echo_enabled = 1;
+    echo->metrics.echo_stamp = stamp_names[echo->stamp];
+    echo->metrics.echo_stamp_offset = config->echo_stamp_offset;
+
+    if (echo->stamp != ECHO_STAMP_NONE) {
+        printf("Echo mode: %s stamp at offset %zu\n", stamp_names[echo->stamp], echo->stamp_offset);
+    }
+    return 0;
+}
+
+int echo_run(EchoServer *echo) {
+    const ServerConfig *config = echo->config;
+    struct pollfd pfd = { .fd = echo->listen_fd, .events = POLLIN };
+    uint64_t next_metrics_ms = monotonic_ms();
+
+    while (1) {
+        int ready = poll(&pfd, 1, ECHO_TICK_MS);
+        if (ready < 0 && errno != EINTR) {
+            perror("Poll error");
+            return -1;
+        }
+
+        if (ready > 0 && (pfd.revents & POLLIN)) {
+            for (int round = 0; round < ECHO_MAX_DRAIN; round++) {
+                int count = recv_batch(echo->listen_fd, &echo->batch);
+                if (count < 0) {
+                    echo->metrics.receive_errors++;
+                    break;
+                }
+                if (count == 0) {
+                    break;
+                }
+                echo_batch(echo, count);
+                if ((unsigned int)count < echo->batch.size) {
+                    break;
+                }
+            }
+        }
+
+        uint64_t now_ms = monotonic_ms();
+        if (config->metrics_interval > 0 && now_ms >= next_metrics_ms) {
+            write_echo_metrics(echo);
+            next_metrics_ms = now_ms + (uint64_t)config->metrics_interval * 1000;
+        }
+    }
+}
+
+void echo_free(EchoServer *echo) {
+    recv_batch_free(&echo->batch);
+    memset(echo, 0, sizeof(*echo));
+}
@@ -0,0 +1,59 @@
+#ifndef ECHO_H
+#define ECHO_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "udp_server.h"
+#include "batch_io.h"
+#include "metrics.h"
+
+/**
+ * Value written into each echoed datagram
+ */
+typedef enum {
+    ECHO_STAMP_NONE = 0,
+    ECHO_STAMP_TIMESTAMP,   // kernel arrival time, nanoseconds since the Unix epoch
+    ECHO_STAMP_SEQUENCE     // count of stamped replies, starting at 0
+} EchoStamp;
+
+/**
+ * Echo mode state: one receive batch whose slots are sent back as they are
+ */
+typedef struct {
+    const ServerConfig *config;
+    FILE *log_fp;
+    int listen_fd;
+    EchoStamp stamp;
+    size_t stamp_offset;
+    uint64_t sequence;
+    RecvBatch batch;
+    ServerMetrics metrics;
+} EchoServer;
+
+/**
+ * Allocate the receive slots
+ *
+ * @param echo Echo server to initialize
+ * @param config Server configuration
+ * @param listen_fd Bound socket
+ * @param log_fp Log file pointer (can be NULL)
+ * @return 0 on success, -1 on error
+ */
+int echo_init(EchoServer *echo, const ServerConfig *config, int listen_fd, FILE *log_fp);
+
+/**
+ * Reflect datagrams to their senders until an error occurs
+ *
+ * @param echo Initialized echo server
+ * @return -1 on fatal error
+ */
+int echo_run(EchoServer *echo);
+
+/**
+ * Release the echo server
+ *
+ * @param echo Echo server to free
+ */
+void echo_free(EchoServer *echo);
+
+#endif /* ECHO_H */
@@ -0,0 +1,291 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "filter.h"
+#include "addr_utils.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FILTER_HAVE_X86 1
+#include <immintrin.h>
+#endif
+
+static const char *impl_names[] = { "scalar", "ssse3", "avx2" };
+
+static int parse_rule(const char *spec, FilterRule *rule) {
+    const char *colon = strchr(spec, ':');
+    if (!colon || colon[1] == '\0') {
+        return -1;
+    }
+
+    size_t action_len = (size_t)(colon - spec);
+    if (action_len == 4 && strncmp(spec, "drop", 4) == 0) {
+        rule->action = FILTER_DROP;
+    } else if (action_len == 3 && strncmp(spec, "tag", 3) == 0) {
+        rule->action = FILTER_TAG;
+    } else if (action_len == 5 && strncmp(spec, "route", 5) == 0) {
+        rule->action = FILTER_ROUTE;
+    } else {
+        return -1;
+    }
+
+    strncpy(rule->pattern, colon + 1, sizeof(rule->pattern) - 1);
+    rule->pattern[sizeof(rule->pattern) - 1] = '\0';
+    rule->len = strlen(rule->pattern);
+    rule->prefix = 0;
+    if (rule->len >= sizeof(rule->prefix)) {
+        memcpy(&rule->prefix, rule->pattern, sizeof(rule->prefix));
+    }
+    rule->hits = 0;
+    return 0;
+}
+
+// Set a bucket bit for every byte value with the given nibble in one table half
+static void set_nibble(uint8_t *table, int nibble, uint8_t bit) {
+    table[nibble] |= bit;
+    table[nibble + 16] |= bit;
+}
+
+static void add_to_tables(Filter *filter, const FilterRule *rule, int bucket) {
+    uint8_t bit = (uint8_t)(1u << bucket);
+    for (int k = 0; k < FILTER_FINGERPRINT; k++) {
+        if ((size_t)k < rule->len) {
+            unsigned char c = (unsigned char)rule->pattern[k];
+            set_nibble(filter->lo[k], c & 0x0f, bit);
+            set_nibble(filter->hi[k], c >> 4, bit);
+        } else {
+            // Short patterns accept any byte past their end
+            for (int n = 0; n < 16; n++) {
+                set_nibble(filter->lo[k], n, bit);
+                set_nibble(filter->hi[k], n, bit);
+            }
+        }
+    }
+}
+
+static int compare_rule_prefixes(const void *a, const void *b, void *arg) {
+    const Filter *filter = arg;
+    const FilterRule *ra = &filter->rules[*(const int *)a];
+    const FilterRule *rb = &filter->rules[*(const int *)b];
+    return strncmp(ra->pattern, rb->pattern, FILTER_FINGERPRINT);
+}
+
+// Put rules with similar prefixes into the same bucket so the nibble masks stay selective
+static void assign_buckets(Filter *filter) {
+    int order[MAX_FILTER_RULES];
+    for (int i = 0; i < filter->rule_count; i++) {
+        order[i] = i;
+    }
+    qsort_r(order, filter->rule_count, sizeof(int), compare_rule_prefixes, filter);
+
+    int per_bucket = (filter->rule_count + FILTER_BUCKETS - 1) / FILTER_BUCKETS;
+    for (int i = 0; i < filter->rule_count; i++) {
+        int index = order[i];
+        int bucket = i / per_bucket;
+        filter->bucket_rules[bucket] |= 1ULL << index;
+        add_to_tables(filter, &filter->rules[index], bucket);
+    }
+}
+
+int filter_init(Filter *filter, const ServerConfig *config) {
+    int result = 0;
+    memset(filter, 0, sizeof(Filter));
+
+    for (int i = 0; i < config->filter_rule_count; i++) {
+        FilterRule *rule = &filter->rules[filter->rule_count];
+        if (parse_rule(config->filter_rules[i], rule) < 0) {
+            fprintf(stderr, "Invalid filter rule: %s\n", config->filter_rules[i]);
+            result = -1;
+            continue;
+        }
+
+        uint64_t mask = 1ULL << filter->rule_count;
+        if (rule->action == FILTER_DROP) {
+            filter->drop_rules |= mask;
+        } else if (rule->action == FILTER_ROUTE) {
+            filter->route_rules |= mask;
+        } else {
+            filter->tag_rules |= mask;
+        }
+        filter->rule_count++;
+    }
+    assign_buckets(filter);
+
+    if (config->filter_route_to[0] != '\0') {
+        if (parse_ipv4_endpoint(config->filter_route_to, &filter->route_addr) < 0) {
+            fprintf(stderr, "Invalid filter route_to address: %s\n", config->filter_route_to);
+            result = -1;
+        } else {
+            filter->have_route = 1;
+        }
+    }
+    if (filter->route_rules && !filter->have_route) {
+        fprintf(stderr, "Filter route rules need filters.route_to; matches will be dropped\n");
+        result = -1;
+    }
+
+    filter->impl = FILTER_IMPL_SCALAR;
+#ifdef FILTER_HAVE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        filter->impl = FILTER_IMPL_AVX2;
+    } else if (__builtin_cpu_supports("ssse3")) {
+        filter->impl = FILTER_IMPL_SSSE3;
+    }
+#endif
+    return result;
+}
+
+// Confirm the patterns of the candidate buckets at one position
+static void verify(const Filter *filter, const char *data, size_t len, size_t pos,
+                   uint8_t buckets, uint64_t *matched) {
+    uint32_t word = 0;
+    if (pos + sizeof(word) <= len) {
+        memcpy(&word, data + pos, sizeof(word));
+    }
+
+    while (buckets) {
+        int bucket = __builtin_ctz(buckets);
+        buckets &= (uint8_t)(buckets - 1);
+
+        uint64_t rules = filter->bucket_rules[bucket] & ~*matched;
+        while (rules) {
+            int index = __builtin_ctzll(rules);
+            rules &= rules - 1;
+            const FilterRule *rule = &filter->rules[index];
+            if (pos + rule->len > len) {
+                continue;
+            }
+            // Compare the first four bytes as one word before calling memcmp
+            if (rule->len >= sizeof(word) && word != rule->prefix) {
+                continue;
+            }
+            if (memcmp(data + pos, rule->pattern, rule->len) == 0) {
+                *matched |= 1ULL << index;
+            }
+        }
+    }
+}
+
+static uint8_t scalar_buckets(const Filter *filter, int k, unsigned char c) {
+    return filter->lo[k][c & 0x0f] & filter->hi[k][c >> 4];
+}
+
+static uint64_t match_scalar(const Filter *filter, const char *data, size_t len, size_t start,
+                             uint64_t matched) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (size_t i = start; i < len; i++) {
+        // Bytes past the end are not checked here; verify() rejects patterns that do not fit
+        uint8_t buckets = scalar_buckets(filter, 0, bytes[i]);
+        for (int k = 1; buckets && k < FILTER_FINGERPRINT && i + k < len; k++) {
+            buckets &= scalar_buckets(filter, k, bytes[i + k]);
+        }
+        if (buckets) {
+            verify(filter, data, len, i, buckets, &matched);
+            if (matched & filter->drop_rules) {
+                break;
+            }
+        }
+    }
+    return matched;
+}
+
+#ifdef FILTER_HAVE_X86
+__attribute__((target("ssse3")))
+static __m128i buckets_ssse3(const Filter *filter, int k, __m128i bytes) {
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+    __m128i lo = _mm_load_si128((const __m128i *)filter->lo[k]);
+    __m128i hi = _mm_load_si128((const __m128i *)filter->hi[k]);
+    return _mm_and_si128(_mm_shuffle_epi8(lo, _mm_and_si128(bytes, nibble)),
+                         _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi16(bytes, 4), nibble)));
+}
+
+__attribute__((target("ssse3")))
+static uint64_t match_ssse3(const Filter *filter, const char *data, size_t len) {
+    const __m128i zero = _mm_setzero_si128();
+    uint64_t matched = 0;
+    size_t i = 0;
+
+    // Fingerprint byte k of position i is read from a load at i + k
+    for (; i + 16 + FILTER_FINGERPRINT - 1 <= len; i += 16) {
+        __m128i candidates = buckets_ssse3(filter, 0, _mm_loadu_si128((const __m128i *)(data + i)));
+        for (int k = 1; k < FILTER_FINGERPRINT; k++) {
+            candidates = _mm_and_si128(candidates,
+                                       buckets_ssse3(filter, k, _mm_loadu_si128((const __m128i *)(data + i + k))));
+        }
+        unsigned int bits = ~(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(candidates, zero)) & 0xffff;
+        if (bits) {
+            uint8_t buckets[16];
+            _mm_storeu_si128((__m128i *)buckets, candidates);
+            while (bits) {
+                int offset = __builtin_ctz(bits);
+                bits &= bits - 1;
+                verify(filter, data, len, i + offset, buckets[offset], &matched);
+            }
+            if (matched & filter->drop_rules) {
+                return matched;
+            }
+        }
+    }
+    return match_scalar(filter, data, len, i, matched);
+}
+
+__attribute__((target("avx2")))
+static __m256i buckets_avx2(const Filter *filter, int k, __m256i bytes) {
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    __m256i lo = _mm256_load_si256((const __m256i *)filter->lo[k]);
+    __m256i hi = _mm256_load_si256((const __m256i *)filter->hi[k]);
+    return _mm256_and_si256(_mm256_shuffle_epi8(lo, _mm256_and_si256(bytes, nibble)),
+                            _mm256_shuffle_epi8(hi, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibble)));
+}
+
+__attribute__((target("avx2")))
+static uint64_t match_avx2(const Filter *filter, const char *data, size_t len) {
+    const __m256i zero = _mm256_setzero_si256();
+    uint64_t matched = 0;
+    size_t i = 0;
+
+    for (; i + 32 + FILTER_FINGERPRINT - 1 <= len; i += 32) {
+        __m256i candidates = buckets_avx2(filter, 0, _mm256_loadu_si256((const __m256i *)(data + i)));
+        for (int k = 1; k < FILTER_FINGERPRINT; k++) {
+            candidates = _mm256_and_si256(candidates,
+                                          buckets_avx2(filter, k, _mm256_loadu_si256((const __m256i *)(data + i + k))));
+        }
+        uint32_t bits = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(candidates, zero));
+        if (bits) {
+            uint8_t buckets[32];
+            _mm256_storeu_si256((__m256i *)buckets, candidates);
+            while (bits) {
+                int offset = __builtin_ctz(bits);
+                bits &= bits - 1;
+                verify(filter, data, len, i + offset, buckets[offset], &matched);
+            }
+            if (matched & filter->drop_rules) {
+                return matched;
+            }
+        }
+    }
+    return match_scalar(filter, data, len, i, matched);
+}
+#endif
+
+uint64_t filter_match(const Filter *filter, const char *data, size_t len) {
+    if (filter->rule_count == 0) {
+        return 0;
+    }
+#ifdef FILTER_HAVE_X86
+    if (filter->impl == FILTER_IMPL_AVX2) {
+        return match_avx2(filter, data, len);
+    }
+    if (filter->impl == FILTER_IMPL_SSSE3) {
+        return match_ssse3(filter, data, len);
+    }
+#endif
+    return match_scalar(filter, data, len, 0, 0);
+}
+
+const char *filter_impl_name(FilterImpl impl) {
+    if (impl < FILTER_IMPL_SCALAR || impl > FILTER_IMPL_AVX2) {
+        return "unknown";
+    }
+    return impl_names[impl];
+}
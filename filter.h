@@ -0,0 +1,97 @@
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <netinet/in.h>
+#include "udp_server.h"
+
+// Patterns are spread over this many buckets of the nibble masks
+#define FILTER_BUCKETS 8
+// Leading pattern bytes checked by the vector prefilter
+#define FILTER_FINGERPRINT 3
+
+/**
+ * Action of a filter rule; when several rules match, drop wins over
+ * route and route over tag
+ */
+typedef enum {
+    FILTER_DROP = 0,    // discard the datagram
+    FILTER_TAG,         // count and log the match, then process normally
+    FILTER_ROUTE        // forward the datagram to filters.route_to instead of handling it
+} FilterAction;
+
+/**
+ * Implementation selected for the running CPU
+ */
+typedef enum {
+    FILTER_IMPL_SCALAR = 0,
+    FILTER_IMPL_SSSE3,
+    FILTER_IMPL_AVX2
+} FilterImpl;
+
+/**
+ * Rule parsed from an "action:pattern" entry of filters.rules
+ */
+typedef struct {
+    FilterAction action;
+    char pattern[MAX_RULE_LENGTH];
+    size_t len;
+    uint32_t prefix;
+    uint64_t hits;
+} FilterRule;
+
+/**
+ * Multi-substring matcher compiled from the rules.
+ * Candidate positions are found with nibble lookup tables over the first
+ * three bytes of each pattern (one bit per bucket) and then verified with
+ * memcmp. The tables are 32 bytes so the AVX2 path can load them directly.
+ */
+typedef struct {
+    FilterRule rules[MAX_FILTER_RULES];
+    int rule_count;
+    uint64_t bucket_rules[FILTER_BUCKETS];
+    uint64_t drop_rules;
+    uint64_t route_rules;
+    uint64_t tag_rules;
+
+    // lo[k] and hi[k] map the low and high nibble of byte k of a candidate
+    // to the buckets whose patterns accept it there
+    uint8_t lo[FILTER_FINGERPRINT][32] __attribute__((aligned(32)));
+    uint8_t hi[FILTER_FINGERPRINT][32] __attribute__((aligned(32)));
+
+    FilterImpl impl;
+    struct sockaddr_in route_addr;
+    int have_route;
+} Filter;
+
+/**
+ * Compile the rules of the filters section and pick the fastest
+ * implementation the CPU supports
+ *
+ * @param filter Filter to initialize
+ * @param config Server configuration
+ * @return 0 on success, -1 if a rule or the route address could not be parsed
+ */
+int filter_init(Filter *filter, const ServerConfig *config);
+
+/**
+ * Find the rules whose pattern occurs in a payload.
+ * Scanning stops early once a drop rule matched.
+ *
+ * @param filter Compiled filter
+ * @param data Payload
+ * @param len Payload length
+ * @return Bit mask of matching rules (bit i = rules[i])
+ */
+uint64_t filter_match(const Filter *filter, const char *data, size_t len);
+
+/**
+ * Name of a filter implementation
+ *
+ * @param impl Implementation
+ * @return Name string
+ */
+const char *filter_impl_name(FilterImpl impl);
+
+#endif /* FILTER_H */
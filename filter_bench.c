@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "filter.h"
+
+// Throughput of the payload filter against a naive memmem() loop.
+// Usage: ./filter_bench [datagram size] [rule count] [total MB]
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Random lowercase text with spaces, similar to text protocols on the wire
+static void fill_text(char *buffer, size_t len) {
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+    for (size_t i = 0; i < len; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        unsigned int r = (unsigned int)(state % 32);
+        buffer[i] = r < 26 ? (char)('a' + r) : ' ';
+    }
+}
+
+static uint64_t naive_match(const Filter *filter, const char *data, size_t len) {
+    uint64_t matched = 0;
+    for (int i = 0; i < filter->rule_count; i++) {
+        if (memmem(data, len, filter->rules[i].pattern, filter->rules[i].len)) {
+            matched |= 1ULL << i;
+        }
+    }
+    return matched;
+}
+
+int main(int argc, char *argv[]) {
+    size_t datagram = argc > 1 ? (size_t)atoi(argv[1]) : 1400;
+    int rule_count = argc > 2 ? atoi(argv[2]) : 16;
+    size_t total = (argc > 3 ? (size_t)atoi(argv[3]) : 256) * 1024 * 1024;
+    if (datagram == 0 || rule_count <= 0 || rule_count > MAX_FILTER_RULES || total < datagram) {
+        fprintf(stderr, "Usage: %s [datagram size] [rule count 1-%d] [total MB]\n", argv[0], MAX_FILTER_RULES);
+        return 1;
+    }
+
+    static ServerConfig config;
+    for (int i = 0; i < rule_count; i++) {
+        // Digits never occur in the generated text, so every byte is scanned
+        snprintf(config.filter_rules[i], MAX_RULE_LENGTH, "drop:%c%ctoken%d",
+                 'a' + i % 26, 'a' + (i * 7) % 26, i);
+    }
+    config.filter_rule_count = rule_count;
+
+    size_t count = total / datagram;
+    char *data = malloc(count * datagram + 64);
+    if (!data) {
+        perror("Memory allocation failed");
+        return 1;
+    }
+    fill_text(data, count * datagram + 64);
+
+    Filter filter;
+    filter_init(&filter, &config);
+    FilterImpl best = filter.impl;
+
+    printf("%zu datagrams of %zu bytes, %d rules\n", count, datagram, rule_count);
+    for (int impl = FILTER_IMPL_SCALAR; impl <= (int)best; impl++) {
+        filter.impl = (FilterImpl)impl;
+        uint64_t hits = 0;
+        double start = now_seconds();
+        for (size_t i = 0; i < count; i++) {
+            hits += filter_match(&filter, data + i * datagram, datagram) != 0;
+        }
+        double elapsed = now_seconds() - start;
+        printf("%-8s %8.2f GB/s  (%llu matches)\n", filter_impl_name(filter.impl),
+               (double)(count * datagram) / elapsed / 1e9, (unsigned long long)hits);
+    }
+
+    uint64_t hits = 0;
+    double start = now_seconds();
+    for (size_t i = 0; i < count; i++) {
+        hits += naive_match(&filter, data + i * datagram, datagram) != 0;
+    }
+    double elapsed = now_seconds() - start;
+    printf("%-8s %8.2f GB/s  (%llu matches)\n", "memmem",
+           (double)(count * datagram) / elapsed / 1e9, (unsigned long long)hits);
+
+    free(data);
+    return 0;
+}
@@ -0,0 +1,108 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include "flow_table.h"
+#include "addr_utils.h"
+
+static uint32_t *flow_bucket(const FlowTable *table, const struct sockaddr_in *client) {
+    return &table->buckets[ipv4_endpoint_hash(client) & table->bucket_mask];
+}
+
+int flow_table_init(FlowTable *table, uint32_t capacity) {
+    memset(table, 0, sizeof(*table));
+    uint32_t buckets = 1;
+    while (buckets < capacity) {
+        buckets <<= 1;
+    }
+    table->entries = calloc(capacity ? capacity : 1, sizeof(FlowEntry));
+    table->buckets = malloc(buckets * sizeof(uint32_t));
+    if (!table->entries || !table->buckets) {
+        flow_table_free(table);
+        return -1;
+    }
+
+    table->bucket_mask = buckets - 1;
+    table->capacity = capacity;
+    for (uint32_t i = 0; i < buckets; i++) {
+        table->buckets[i] = FLOW_NONE;
+    }
+    for (uint32_t i = 0; i < capacity; i++) {
+        table->entries[i].fd = -1;
+        table->entries[i].hash_next = i + 1 < capacity ? i + 1 : FLOW_NONE;
+    }
+    table->free_head = capacity ? 0 : FLOW_NONE;
+    return 0;
+}
+
+uint32_t flow_table_lookup(const FlowTable *table, const struct sockaddr_in *client) {
+    uint32_t index = *flow_bucket(table, client);
+    while (index != FLOW_NONE) {
+        if (same_ipv4_endpoint(&table->entries[index].client, client)) {
+            return index;
+        }
+        index = table->entries[index].hash_next;
+    }
+    return FLOW_NONE;
+}
+
+uint32_t flow_table_open(FlowTable *table, const struct sockaddr_in *client, const struct sockaddr_in *upstream) {
+    if (table->free_head == FLOW_NONE) {
+        return FLOW_NONE;
+    }
+
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        return FLOW_NONE;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    if (connect(fd, (const struct sockaddr *)upstream, sizeof(*upstream)) < 0) {
+        close(fd);
+        return FLOW_NONE;
+    }
+
+    uint32_t index = table->free_head;
+    FlowEntry *entry = &table->entries[index];
+    table->free_head = entry->hash_next;
+    entry->client = *client;
+    entry->fd = fd;
+    entry->in_use = 1;
+
+    uint32_t *bucket = flow_bucket(table, client);
+    entry->hash_next = *bucket;
+    *bucket = index;
+    table->active++;
+    return index;
+}
+
+void flow_table_close(FlowTable *table, uint32_t index) {
+    FlowEntry *entry = &table->entries[index];
+
+    // Unlink from the hash chain
+    uint32_t *link = flow_bucket(table, &entry->client);
+    while (*link != index) {
+        link = &table->entries[*link].hash_next;
+    }
+    *link = entry->hash_next;
+
+    close(entry->fd);
+    entry->in_use = 0;
+    entry->fd = -1;
+    entry->hash_next = table->free_head;
+    table->free_head = index;
+    table->active--;
+}
+
+void flow_table_free(FlowTable *table) {
+    if (table->entries) {
+        for (uint32_t i = 0; i < table->capacity; i++) {
+            if (table->entries[i].in_use) {
+                close(table->entries[i].fd);
+            }
+        }
+    }
+    free(table->entries);
+    free(table->buckets);
+    memset(table, 0, sizeof(*table));
+}
@@ -0,0 +1,78 @@
+#ifndef FLOW_TABLE_H
+#define FLOW_TABLE_H
+
+#include <stdint.h>
+#include <netinet/in.h>
+
+// Index of no flow: empty bucket, end of a chain or a full table
+#define FLOW_NONE UINT32_MAX
+
+/**
+ * Client flow: the client address and the upstream socket opened for it.
+ * The socket's local port is what maps upstream replies back to the client.
+ */
+typedef struct {
+    struct sockaddr_in client;
+    int fd;
+    int in_use;
+    uint32_t hash_next;
+} FlowEntry;
+
+/**
+ * Fixed-size flow slab, looked up by client address through a power-of-two
+ * bucket array with chaining. Callers keep their per-flow state in arrays
+ * indexed like the entries.
+ */
+typedef struct {
+    FlowEntry *entries;
+    uint32_t *buckets;
+    uint32_t bucket_mask;
+    uint32_t capacity;
+    uint32_t free_head;
+    uint32_t active;
+} FlowTable;
+
+/**
+ * Allocate the entries and buckets
+ *
+ * @param table Table to initialize
+ * @param capacity Maximum number of open flows
+ * @return 0 on success, -1 on allocation failure
+ */
+int flow_table_init(FlowTable *table, uint32_t capacity);
+
+/**
+ * Find the flow of a client
+ *
+ * @param table Flow table
+ * @param client Client address
+ * @return Flow index, or FLOW_NONE if the client has no flow
+ */
+uint32_t flow_table_lookup(const FlowTable *table, const struct sockaddr_in *client);
+
+/**
+ * Open a non-blocking UDP socket connected to the upstream and add a flow for the client
+ *
+ * @param table Flow table
+ * @param client Client address
+ * @param upstream Address the flow socket is connected to
+ * @return Flow index, or FLOW_NONE if the table is full or the socket failed
+ */
+uint32_t flow_table_open(FlowTable *table, const struct sockaddr_in *client, const struct sockaddr_in *upstream);
+
+/**
+ * Remove a flow and close its socket
+ *
+ * @param table Flow table
+ * @param index Index of an open flow
+ */
+void flow_table_close(FlowTable *table, uint32_t index);
+
+/**
+ * Close all flow sockets and release the table
+ *
+ * @param table Table to free
+ */
+void flow_table_free(FlowTable *table);
+
+#endif /* FLOW_TABLE_H */
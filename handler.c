@@ -0,0 +1,49 @@
+#include <string.h>
+#include "handler.h"
+
+static const RequestHandler *handlers[] = {
+    &reply_handler,
+    &resolve_handler,
+    &pubsub_handler,
+    &kv_handler,
+    &statsd_handler,
+    &syslog_handler,
+    NULL
+};
+
+const RequestHandler *find_handler(const char *name) {
+    for (int i = 0; handlers[i]; i++) {
+        if (strcmp(handlers[i]->name, name) == 0) {
+            return handlers[i];
+        }
+    }
+    return NULL;
+}
+
+int handler_defer(HandlerCall *call, PendingContinuation continuation, void *user_data,
+                  PendingToken *token) {
+    return pending_begin(call->pending, call->client, continuation, user_data,
+                         call->timeout_ms, token);
+}
+
+void handler_reply(HandlerCall *call, const char *response) {
+    call->response = response;
+    call->response_len = strlen(response);
+}
+
+// Default handler: answer every datagram with the configured response message
+static int reply_init(const ServerConfig *config, void **state) {
+    *state = (void *)config->response_message;
+    return 0;
+}
+
+static HandlerResult reply_handle(void *state, HandlerCall *call) {
+    handler_reply(call, state);
+    return HANDLER_DONE;
+}
+
+const RequestHandler reply_handler = {
+    .name = "reply",
+    .init = reply_init,
+    .handle = reply_handle
+};
@@ -0,0 +1,94 @@
+#ifndef HANDLER_H
+#define HANDLER_H
+
+#include <stddef.h>
+#include <netinet/in.h>
+#include "udp_server.h"
+#include "pending.h"
+#include "metrics.h"
+
+/**
+ * Outcome of a request handler
+ */
+typedef enum {
+    HANDLER_DONE = 0,   // call->response holds the reply (may be empty)
+    HANDLER_PENDING,    // the reply will arrive through pending_complete()
+    HANDLER_DROP        // send nothing
+} HandlerResult;
+
+/**
+ * One request as seen by a handler.
+ * A synchronous reply is either built in response_buffer or points at
+ * memory that stays valid until the batch is sent (e.g. handler state).
+ */
+typedef struct {
+    const char *payload;
+    size_t len;
+    const struct sockaddr_in *client;
+
+    char *response_buffer;
+    size_t response_buffer_size;
+    const char *response;
+    size_t response_len;
+
+    PendingTable *pending;
+    uint32_t timeout_ms;
+    int sockfd;
+} HandlerCall;
+
+/**
+ * Request handler selected with server.handler in config.yaml.
+ * tick runs on every loop iteration and report before each metrics
+ * snapshot; both are optional. Payloads of quiet handlers (binary or
+ * high-rate traffic) are not printed or logged.
+ */
+typedef struct {
+    const char *name;
+    int (*init)(const ServerConfig *config, void **state);
+    HandlerResult (*handle)(void *state, HandlerCall *call);
+    void (*destroy)(void *state);
+    void (*tick)(void *state, uint64_t now_ms);
+    void (*report)(void *state, ServerMetrics *metrics);
+    int quiet;
+} RequestHandler;
+
+/**
+ * Look up a request handler by name
+ *
+ * @param name Handler name
+ * @return Handler, or NULL if there is no handler with that name
+ */
+const RequestHandler *find_handler(const char *name);
+
+/**
+ * Defer the reply of the current call.
+ * Hand the token to whatever produces the result and return HANDLER_PENDING.
+ *
+ * @param call Current handler call
+ * @param continuation Reply builder, or NULL to send the completion data as is
+ * @param user_data Argument for the continuation
+ * @param token Pointer to store the request token
+ * @return 0 on success, -1 if too many requests are in flight
+ */
+int handler_defer(HandlerCall *call, PendingContinuation continuation, void *user_data,
+                  PendingToken *token);
+
+/**
+ * Set a synchronous reply that references constant or handler-owned memory
+ *
+ * @param call Current handler call
+ * @param response Reply payload
+ */
+void handler_reply(HandlerCall *call, const char *response);
+
+/**
+ * Built-in handlers
+ */
+extern const RequestHandler reply_handler;
+extern const RequestHandler resolve_handler;
+extern const RequestHandler pubsub_handler;
+extern const RequestHandler kv_handler;
+extern const RequestHandler statsd_handler;
+extern const RequestHandler syslog_handler;
+
+#endif /* HANDLER_H */
@@ -0,0 +1,272 @@
+#include <stdlib.h>
+#include <string.h>
+#include "handler.h"
+#include "kv_store.h"
+
+// Key-value handler with a binary protocol. Multi-byte lengths are big-endian.
+// Request:  magic 'K' | opcode | opaque[4] | body
+//   GET, DELETE: key_len[1] key
+//   SET:         key_len[1] value_len[2] key value
+//   MGET:        count[1] then count x (key_len[1] key)
+// Response: magic 'K' | opcode | opaque[4] | status | body
+//   GET:  value_len[2] value when found
+//   MGET: count[1] then count x (status[1] value_len[2] value); if not all
+//         values fit in one datagram the status is KV_STATUS_PARTIAL and
+//         count tells how many keys were answered
+
+#define KV_MAGIC 'K'
+#define KV_HEADER_SIZE 6
+#define KV_RESPONSE_HEADER_SIZE 7
+
+enum {
+    KV_OP_GET = 1,
+    KV_OP_SET = 2,
+    KV_OP_DELETE = 3,
+    KV_OP_MGET = 4
+};
+
+enum {
+    KV_STATUS_OK = 0,
+    KV_STATUS_NOT_FOUND = 1,
+    KV_STATUS_BAD_REQUEST = 2,
+    KV_STATUS_TOO_LARGE = 3,
+    KV_STATUS_PARTIAL = 4
+};
+
+typedef struct {
+    KvStore store;
+    uint64_t gets;
+    uint64_t hits;
+    uint64_t sets;
+    uint64_t deletes;
+    uint64_t bad_requests;
+} KvState;
+
+static uint16_t read_u16(const unsigned char *p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static void write_u16(unsigned char *p, size_t value) {
+    p[0] = (unsigned char)(value >> 8);
+    p[1] = (unsigned char)value;
+}
+
+// Read a length-prefixed key at *pos; returns 0 on success, -1 if malformed
+static int read_key(const unsigned char *body, size_t len, size_t *pos, const char **key, size_t *key_len) {
+    if (*pos >= len) {
+        return -1;
+    }
+    *key_len = body[*pos];
+    *pos += 1;
+    if (*key_len == 0 || *pos + *key_len > len) {
+        return -1;
+    }
+    *key = (const char *)body + *pos;
+    *pos += *key_len;
+    return 0;
+}
+
+static size_t finish(unsigned char *response, unsigned char status, size_t len) {
+    response[KV_HEADER_SIZE] = status;
+    return len;
+}
+
+static size_t handle_get(KvState *state, const unsigned char *body, size_t len,
+                         unsigned char *response, size_t size) {
+    size_t pos = 0;
+    const char *key;
+    size_t key_len;
+    if (read_key(body, len, &pos, &key, &key_len) < 0 || pos != len) {
+        state->bad_requests++;
+        return finish(response, KV_STATUS_BAD_REQUEST, KV_RESPONSE_HEADER_SIZE);
+    }
+
+    const char *value;
+    size_t value_len;
+    state->gets++;
+    if (!kv_store_get(&state->store, key, key_len, &value, &value_len)) {
+        return finish(response, KV_STATUS_NOT_FOUND, KV_RESPONSE_HEADER_SIZE);
+    }
+    state->hits++;
+    if (KV_RESPONSE_HEADER_SIZE + 2 + value_len > size) {
+        return finish(response, KV_STATUS_TOO_LARGE, KV_RESPONSE_HEADER_SIZE);
+    }
+
+    write_u16(response + KV_RESPONSE_HEADER_SIZE, value_len);
+    memcpy(response + KV_RESPONSE_HEADER_SIZE + 2, value, value_len);
+    return finish(response, KV_STATUS_OK, KV_RESPONSE_HEADER_SIZE + 2 + value_len);
+}
+
+static size_t handle_mget(KvState *state, const unsigned char *body, size_t len,
+                          unsigned char *response, size_t size) {
+    if (len < 1) {
+        state->bad_requests++;
+        return finish(response, KV_STATUS_BAD_REQUEST, KV_RESPONSE_HEADER_SIZE);
+    }
+
+    unsigned int count = body[0];
+    unsigned int answered = 0;
+    unsigned char status = KV_STATUS_OK;
+    size_t pos = 1;
+    size_t out = KV_RESPONSE_HEADER_SIZE + 1;
+
+    for (unsigned int i = 0; i < count; i++) {
+        const char *key;
+        size_t key_len;
+        if (read_key(body, len, &pos, &key, &key_len) < 0) {
+            state->bad_requests++;
+            return finish(response, KV_STATUS_BAD_REQUEST, KV_RESPONSE_HEADER_SIZE);
+        }
+
+        const char *value = NULL;
+        size_t value_len = 0;
+        state->gets++;
+        int found = kv_store_get(&state->store, key, key_len, &value, &value_len);
+        if (out + 3 + value_len > size) {
+            // Keep the datagram within the reply buffer; the client asks again for the rest
+            status = KV_STATUS_PARTIAL;
+            break;
+        }
+
+        response[out] = found ? KV_STATUS_OK : KV_STATUS_NOT_FOUND;
+        write_u16(response + out + 1, value_len);
+        if (found) {
+            state->hits++;
+            memcpy(response + out + 3, value, value_len);
+        }
+        out += 3 + value_len;
+        answered++;
+    }
+
+    response[KV_RESPONSE_HEADER_SIZE] = (unsigned char)answered;
+    return finish(response, status, out);
+}
+
+static size_t handle_set(KvState *state, const unsigned char *body, size_t len, unsigned char *response) {
+    if (len < 3) {
+        state->bad_requests++;
+        return finish(response, KV_STATUS_BAD_REQUEST, KV_RESPONSE_HEADER_SIZE);
+    }
+    size_t key_len = body[0];
+    size_t value_len = read_u16(body + 1);
+    if (key_len == 0 || 3 + key_len + value_len != len) {
+        state->bad_requests++;
+        return finish(response, KV_STATUS_BAD_REQUEST, KV_RESPONSE_HEADER_SIZE);
+    }
+
+    state->sets++;
+    const char *key = (const char *)body + 3;
+    if (kv_store_set(&state->store, key, key_len, key + key_len, value_len) < 0) {
+        return finish(response, KV_STATUS_TOO_LARGE, KV_RESPONSE_HEADER_SIZE);
+    }
+    return finish(response, KV_STATUS_OK, KV_RESPONSE_HEADER_SIZE);
+}
+
+static size_t handle_delete(KvState *state, const unsigned char *body, size_t len, unsigned char *response) {
+    size_t pos = 0;
+    const char *key;
+    size_t key_len;
+    if (read_key(body, len, &pos, &key, &key_len) < 0 || pos != len) {
+        state->bad_requests++;
+        return finish(response, KV_STATUS_BAD_REQUEST, KV_RESPONSE_HEADER_SIZE);
+    }
+
+    state->deletes++;
+    unsigned char status = kv_store_delete(&state->store, key, key_len) ? KV_STATUS_OK : KV_STATUS_NOT_FOUND;
+    return finish(response, status, KV_RESPONSE_HEADER_SIZE);
+}
+
+static HandlerResult kv_handle(void *arg, HandlerCall *call) {
+    KvState *state = arg;
+    const unsigned char *payload = (const unsigned char *)call->payload;
+    unsigned char *response = (unsigned char *)call->response_buffer;
+    size_t size = call->response_buffer_size;
+
+    // Datagrams without a valid header cannot be answered meaningfully
+    if (call->len < KV_HEADER_SIZE || payload[0] != KV_MAGIC || size < KV_RESPONSE_HEADER_SIZE + 1) {
+        state->bad_requests++;
+        return HANDLER_DROP;
+    }
+
+    // Echo magic, opcode and opaque so clients can match replies to requests
+    memcpy(response, payload, KV_HEADER_SIZE);
+    const unsigned char *body = payload + KV_HEADER_SIZE;
+    size_t len = call->len - KV_HEADER_SIZE;
+    size_t response_len;
+
+    switch (payload[1]) {
+        case KV_OP_GET:
+            response_len = handle_get(state, body, len, response, size);
+            break;
+        case KV_OP_SET:
+            response_len = handle_set(state, body, len, response);
+            break;
+        case KV_OP_DELETE:
+            response_len = handle_delete(state, body, len, response);
+            break;
+        case KV_OP_MGET:
+            response_len = handle_mget(state, body, len, response, size);
+            break;
+        default:
+            state->bad_requests++;
+            response_len = finish(response, KV_STATUS_BAD_REQUEST, KV_RESPONSE_HEADER_SIZE);
+            break;
+    }
+
+    call->response = call->response_buffer;
+    call->response_len = response_len;
+    return HANDLER_DONE;
+}
+
+static void kv_report(void *arg, ServerMetrics *metrics) {
+    KvState *state = arg;
+    metrics->kv_enabled = 1;
+    metrics->kv_items = 0;
+    metrics->kv_bytes_used = 0;
+    metrics->kv_arena_used = 0;
+    metrics->kv_evictions = 0;
+    metrics->kv_page_reclaims = 0;
+    metrics->kv_alloc_failures = 0;
+    for (int i = 0; i < state->store.shard_count; i++) {
+        const KvShard *shard = &state->store.shards[i];
+        metrics->kv_items += shard->items;
+        metrics->kv_bytes_used += shard->bytes_used;
+        metrics->kv_arena_used += shard->arena_used;
+        metrics->kv_evictions += shard->evictions;
+        metrics->kv_page_reclaims += shard->page_reclaims;
+        metrics->kv_alloc_failures += shard->alloc_failures;
+    }
+    metrics->kv_gets = state->gets;
+    metrics->kv_hits = state->hits;
+    metrics->kv_sets = state->sets;
+    metrics->kv_deletes = state->deletes;
+    metrics->kv_bad_requests = state->bad_requests;
+}
+
+static void kv_destroy(void *arg) {
+    KvState *state = arg;
+    kv_store_free(&state->store);
+    free(state);
+}
+
+static int kv_init(const ServerConfig *config, void **state_out) {
+    KvState *state = calloc(1, sizeof(KvState));
+    if (!state) {
+        return -1;
+    }
+    if (kv_store_init(&state->store, (size_t)config->kv_memory_mb * 1024 * 1024, config->kv_shards) < 0) {
+        free(state);
+        return -1;
+    }
+    *state_out = state;
+    return 0;
+}
+
+const RequestHandler kv_handler = {
+    .name = "kv",
+    .init = kv_init,
+    .handle = kv_handle,
+    .destroy = kv_destroy,
+    .report = kv_report,
+    .quiet = 1
+};
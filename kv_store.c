@@ -0,0 +1,408 @@
+#include <stdlib.h>
+#include <string.h>
+#include "kv_store.h"
+
+#define KV_ITEM(shard, ref) ((KvItem *)((shard)->arena + (size_t)((ref) - 1) * KV_ALIGN))
+#define KV_KEY(item) ((char *)(item) + sizeof(KvItem))
+
+static uint64_t kv_hash(const char *key, size_t len) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)key[i];
+        hash *= 0x100000001b3ULL;
+    }
+    // Finalize so both halves of the hash are well mixed
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+static uint32_t round_up_pow2(uint64_t value) {
+    uint32_t result = 1;
+    while (result < value && result < 0x80000000U) {
+        result <<= 1;
+    }
+    return result;
+}
+
+static int size_class_for(size_t size) {
+    size_t chunk = KV_MIN_CHUNK;
+    for (int i = 0; i < KV_CLASS_COUNT; i++, chunk <<= 1) {
+        if (size <= chunk) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static KvShard *shard_for(KvStore *store, uint64_t hash) {
+    return &store->shards[(hash >> 32) % (uint64_t)store->shard_count];
+}
+
+// Find the table slot holding a key; returns -1 if absent
+static int64_t find_slot(KvShard *shard, uint32_t hash, const char *key, size_t key_len) {
+    uint32_t slot = hash & shard->slot_mask;
+    while (shard->slots[slot].ref != 0) {
+        if (shard->slots[slot].hash == hash) {
+            KvItem *item = KV_ITEM(shard, shard->slots[slot].ref);
+            if (item->key_len == key_len && memcmp(KV_KEY(item), key, key_len) == 0) {
+                return slot;
+            }
+        }
+        slot = (slot + 1) & shard->slot_mask;
+    }
+    return -1;
+}
+
+// Linear probing deletion by backward shift, so lookups never need tombstones
+static void delete_slot(KvShard *shard, uint32_t hole) {
+    uint32_t slot = hole;
+    while (1) {
+        slot = (slot + 1) & shard->slot_mask;
+        if (shard->slots[slot].ref == 0) {
+            break;
+        }
+        uint32_t home = shard->slots[slot].hash & shard->slot_mask;
+        if (((slot - home) & shard->slot_mask) >= ((slot - hole) & shard->slot_mask)) {
+            shard->slots[hole] = shard->slots[slot];
+            hole = slot;
+        }
+    }
+    shard->slots[hole].ref = 0;
+}
+
+static void free_chunk(KvShard *shard, uint32_t ref) {
+    KvItem *item = KV_ITEM(shard, ref);
+    KvClass *cls = &shard->classes[item->size_class];
+    item->live = 0;
+    item->next_free = cls->free_head;
+    cls->free_head = ref;
+    shard->items--;
+    shard->bytes_used -= cls->chunk_size;
+}
+
+// Second-chance scan over the chunks of one class; returns a chunk whose item was evicted
+static uint32_t evict_chunk(KvShard *shard, KvClass *cls) {
+    for (uint32_t scanned = 0; scanned < cls->count * 2; scanned++) {
+        uint32_t ref = cls->chunks[cls->hand];
+        cls->hand = (cls->hand + 1) % cls->count;
+
+        KvItem *item = KV_ITEM(shard, ref);
+        if (!item->live) {
+            continue;
+        }
+        if (item->referenced) {
+            item->referenced = 0;
+            continue;
+        }
+
+        int64_t slot = find_slot(shard, item->hash, KV_KEY(item), item->key_len);
+        if (slot >= 0) {
+            delete_slot(shard, (uint32_t)slot);
+        }
+        shard->items--;
+        shard->bytes_used -= cls->chunk_size;
+        shard->evictions++;
+        return ref;
+    }
+    return 0;
+}
+
+static uint32_t page_of(const KvShard *shard, uint32_t ref) {
+    return (uint32_t)((size_t)(ref - 1) * KV_ALIGN / shard->page_size);
+}
+
+static void touch_page(KvShard *shard, uint32_t ref) {
+    shard->page_stamps[page_of(shard, ref)] = ++shard->clock;
+}
+
+// Grow a class's chunk array so one more page fits
+static int reserve_page(KvShard *shard, KvClass *cls) {
+    uint32_t per_page = (uint32_t)(shard->page_size / cls->chunk_size);
+    if (cls->count + per_page > cls->capacity) {
+        uint32_t capacity = cls->capacity ? cls->capacity : 64;
+        while (capacity < cls->count + per_page) {
+            capacity *= 2;
+        }
+        uint32_t *chunks = realloc(cls->chunks, capacity * sizeof(uint32_t));
+        if (!chunks) {
+            return -1;
+        }
+        cls->chunks = chunks;
+        cls->capacity = capacity;
+    }
+    return 0;
+}
+
+// Append the chunks of a page to a class and put them all on its free list
+static void assign_page(KvShard *shard, int size_class, uint32_t page) {
+    KvClass *cls = &shard->classes[size_class];
+    uint32_t per_page = (uint32_t)(shard->page_size / cls->chunk_size);
+    uint32_t first = (uint32_t)((size_t)page * shard->page_size / KV_ALIGN) + 1;
+    // Push in reverse so the free list hands out the page front to back
+    for (uint32_t i = per_page; i-- > 0;) {
+        uint32_t ref = first + i * (cls->chunk_size / KV_ALIGN);
+        KvItem *item = KV_ITEM(shard, ref);
+        item->live = 0;
+        item->next_free = cls->free_head;
+        cls->free_head = ref;
+    }
+    for (uint32_t i = 0; i < per_page; i++) {
+        cls->chunks[cls->count++] = first + i * (cls->chunk_size / KV_ALIGN);
+    }
+    shard->page_stamps[page] = shard->clock;
+}
+
+// Evict every item of the page under a class's CLOCK hand and detach the page from that class
+static uint32_t release_hand_page(KvShard *shard, KvClass *cls) {
+    uint32_t per_page = (uint32_t)(shard->page_size / cls->chunk_size);
+    uint32_t group = cls->hand - cls->hand % per_page;
+    uint32_t page = page_of(shard, cls->chunks[group]);
+
+    for (uint32_t i = group; i < group + per_page; i++) {
+        KvItem *item = KV_ITEM(shard, cls->chunks[i]);
+        if (!item->live) {
+            continue;
+        }
+        int64_t slot = find_slot(shard, item->hash, KV_KEY(item), item->key_len);
+        if (slot >= 0) {
+            delete_slot(shard, (uint32_t)slot);
+        }
+        item->live = 0;
+        shard->items--;
+        shard->bytes_used -= cls->chunk_size;
+        shard->evictions++;
+    }
+
+    // Unlink the page's free chunks
+    uint32_t *link = &cls->free_head;
+    while (*link != 0) {
+        if (page_of(shard, *link) == page) {
+            *link = KV_ITEM(shard, *link)->next_free;
+        } else {
+            link = &KV_ITEM(shard, *link)->next_free;
+        }
+    }
+
+    // Pages occupy equal-sized runs of the chunk array, so the last run fills the gap
+    cls->count -= per_page;
+    if (group != cls->count) {
+        memcpy(&cls->chunks[group], &cls->chunks[cls->count], per_page * sizeof(uint32_t));
+    }
+    cls->hand = cls->count ? group % cls->count : 0;
+    shard->page_reclaims++;
+    return page;
+}
+
+// Class whose next CLOCK victim sits in the least recently used page; prefers the requesting class on ties
+static int oldest_victim_class(KvShard *shard, int size_class) {
+    int victim = -1;
+    uint64_t oldest = UINT64_MAX;
+    for (int c = 0; c < KV_CLASS_COUNT; c++) {
+        int i = (size_class + c) % KV_CLASS_COUNT;
+        KvClass *cls = &shard->classes[i];
+        if (cls->count == 0) {
+            continue;
+        }
+        uint64_t stamp = shard->page_stamps[page_of(shard, cls->chunks[cls->hand])];
+        if (stamp < oldest) {
+            oldest = stamp;
+            victim = i;
+        }
+    }
+    return victim;
+}
+
+// Take a chunk from the free list, an unassigned page or the CLOCK, in that order. The
+// CLOCK victim comes from the requesting class, or else a whole page moves over to it.
+static uint32_t alloc_chunk(KvShard *shard, int size_class) {
+    KvClass *cls = &shard->classes[size_class];
+    uint32_t ref = 0;
+
+    if (cls->chunk_size > shard->page_size) {
+        return 0;
+    }
+
+    if (cls->free_head == 0) {
+        int victim = -1;
+        if (shard->arena_used + shard->page_size > shard->arena_size) {
+            victim = oldest_victim_class(shard, size_class);
+            if (victim < 0) {
+                return 0;
+            }
+        }
+
+        if (victim == size_class) {
+            ref = evict_chunk(shard, cls);
+        } else if (reserve_page(shard, cls) == 0) {
+            uint32_t page;
+            if (victim < 0) {
+                page = (uint32_t)(shard->arena_used / shard->page_size);
+                shard->arena_used += shard->page_size;
+            } else {
+                page = release_hand_page(shard, &shard->classes[victim]);
+            }
+            assign_page(shard, size_class, page);
+        }
+    }
+
+    if (ref == 0 && cls->free_head != 0) {
+        ref = cls->free_head;
+        cls->free_head = KV_ITEM(shard, ref)->next_free;
+    }
+
+    if (ref != 0) {
+        shard->items++;
+        shard->bytes_used += cls->chunk_size;
+    }
+    return ref;
+}
+
+int kv_store_init(KvStore *store, size_t memory_limit, int shard_count) {
+    memset(store, 0, sizeof(KvStore));
+    store->shards = calloc(shard_count, sizeof(KvShard));
+    if (!store->shards) {
+        return -1;
+    }
+    store->shard_count = shard_count;
+
+    size_t arena_size = memory_limit / shard_count;
+    // Offsets must fit the 32-bit references
+    if (arena_size / KV_ALIGN >= UINT32_MAX) {
+        arena_size = (size_t)(UINT32_MAX - 1) * KV_ALIGN;
+    }
+    // Tiny arenas get smaller pages; chunks larger than a page are then refused
+    size_t page_size = KV_PAGE_SIZE;
+    while (page_size > KV_MIN_CHUNK && page_size > arena_size) {
+        page_size >>= 1;
+    }
+    arena_size -= arena_size % page_size;
+    uint32_t page_count = (uint32_t)(arena_size / page_size);
+
+    for (int i = 0; i < shard_count; i++) {
+        KvShard *shard = &store->shards[i];
+        // Enough slots for an arena full of minimum-size items at half load
+        uint32_t slot_count = round_up_pow2((uint64_t)(arena_size / KV_MIN_CHUNK) * 2);
+
+        shard->arena = malloc(arena_size);
+        shard->slots = calloc(slot_count, sizeof(KvSlot));
+        shard->page_stamps = calloc(page_count ? page_count : 1, sizeof(uint64_t));
+        if (!shard->arena || !shard->slots || !shard->page_stamps) {
+            kv_store_free(store);
+            return -1;
+        }
+        shard->arena_size = arena_size;
+        shard->page_size = page_size;
+        shard->slot_mask = slot_count - 1;
+        for (int c = 0; c < KV_CLASS_COUNT; c++) {
+            shard->classes[c].chunk_size = (uint32_t)KV_MIN_CHUNK << c;
+        }
+    }
+    return 0;
+}
+
+void kv_store_free(KvStore *store) {
+    if (!store->shards) {
+        return;
+    }
+    for (int i = 0; i < store->shard_count; i++) {
+        KvShard *shard = &store->shards[i];
+        for (int c = 0; c < KV_CLASS_COUNT; c++) {
+            free(shard->classes[c].chunks);
+        }
+        free(shard->arena);
+        free(shard->slots);
+        free(shard->page_stamps);
+    }
+    free(store->shards);
+    store->shards = NULL;
+}
+
+int kv_store_get(KvStore *store, const char *key, size_t key_len, const char **value, size_t *value_len) {
+    uint64_t hash = kv_hash(key, key_len);
+    KvShard *shard = shard_for(store, hash);
+
+    int64_t slot = find_slot(shard, (uint32_t)hash, key, key_len);
+    if (slot < 0) {
+        return 0;
+    }
+
+    KvItem *item = KV_ITEM(shard, shard->slots[slot].ref);
+    item->referenced = 1;
+    touch_page(shard, shard->slots[slot].ref);
+    *value = KV_KEY(item) + item->key_len;
+    *value_len = item->value_len;
+    return 1;
+}
+
+int kv_store_set(KvStore *store, const char *key, size_t key_len, const char *value, size_t value_len) {
+    if (key_len == 0 || key_len > KV_MAX_KEY || value_len > UINT16_MAX) {
+        return -1;
+    }
+    int size_class = size_class_for(sizeof(KvItem) + key_len + value_len);
+    if (size_class < 0) {
+        return -1;
+    }
+
+    uint64_t hash = kv_hash(key, key_len);
+    KvShard *shard = shard_for(store, hash);
+
+    int64_t slot = find_slot(shard, (uint32_t)hash, key, key_len);
+    if (slot >= 0) {
+        uint32_t ref = shard->slots[slot].ref;
+        KvItem *item = KV_ITEM(shard, ref);
+        if (item->size_class == size_class) {
+            // Same chunk size: overwrite in place
+            memcpy(KV_KEY(item) + key_len, value, value_len);
+            item->value_len = (uint16_t)value_len;
+            item->referenced = 1;
+            touch_page(shard, ref);
+            return 0;
+        }
+        delete_slot(shard, (uint32_t)slot);
+        free_chunk(shard, ref);
+    }
+
+    uint32_t ref = alloc_chunk(shard, size_class);
+    if (ref == 0) {
+        shard->alloc_failures++;
+        return -1;
+    }
+
+    KvItem *item = KV_ITEM(shard, ref);
+    item->hash = (uint32_t)hash;
+    item->next_free = 0;
+    item->key_len = (uint16_t)key_len;
+    item->value_len = (uint16_t)value_len;
+    item->size_class = (uint8_t)size_class;
+    item->referenced = 0;
+    item->live = 1;
+    memcpy(KV_KEY(item), key, key_len);
+    memcpy(KV_KEY(item) + key_len, value, value_len);
+    touch_page(shard, ref);
+
+    // Eviction may have shifted slots, so probe for a free one afresh
+    uint32_t free_slot = (uint32_t)hash & shard->slot_mask;
+    while (shard->slots[free_slot].ref != 0) {
+        free_slot = (free_slot + 1) & shard->slot_mask;
+    }
+    shard->slots[free_slot].ref = ref;
+    shard->slots[free_slot].hash = (uint32_t)hash;
+    return 0;
+}
+
+int kv_store_delete(KvStore *store, const char *key, size_t key_len) {
+    uint64_t hash = kv_hash(key, key_len);
+    KvShard *shard = shard_for(store, hash);
+
+    int64_t slot = find_slot(shard, (uint32_t)hash, key, key_len);
+    if (slot < 0) {
+        return 0;
+    }
+
+    uint32_t ref = shard->slots[slot].ref;
+    delete_slot(shard, (uint32_t)slot);
+    free_chunk(shard, ref);
+    return 1;
+}
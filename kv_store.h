@@ -0,0 +1,137 @@
+#ifndef KV_STORE_H
+#define KV_STORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Largest key accepted by the store
+#define KV_MAX_KEY 250
+// Item chunks come in power-of-two size classes starting at 64 bytes
+#define KV_MIN_CHUNK 64
+#define KV_CLASS_COUNT 12
+// Arena offsets are stored in units of this alignment
+#define KV_ALIGN 8
+// Arenas are handed to size classes in pages that hold one largest chunk
+#define KV_PAGE_SIZE ((size_t)KV_MIN_CHUNK << (KV_CLASS_COUNT - 1))
+
+/**
+ * Item header at the start of an arena chunk, followed by the key and value
+ */
+typedef struct {
+    uint32_t hash;
+    uint32_t next_free;
+    uint16_t key_len;
+    uint16_t value_len;
+    uint8_t size_class;
+    uint8_t referenced;
+    uint8_t live;
+    uint8_t unused;
+} KvItem;
+
+/**
+ * Hash table slot: arena reference (offset / KV_ALIGN + 1, 0 = empty)
+ * and the low hash bits, so probing and deletion rarely touch the arena
+ */
+typedef struct {
+    uint32_t ref;
+    uint32_t hash;
+} KvSlot;
+
+/**
+ * Chunks of one size class and the CLOCK hand that picks eviction victims.
+ * Chunks are added a whole page at a time, so the chunks of one page are
+ * adjacent in the array.
+ */
+typedef struct {
+    uint32_t chunk_size;
+    uint32_t free_head;
+    uint32_t *chunks;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t hand;
+} KvClass;
+
+/**
+ * Independent part of the key space with its own arena and table
+ */
+typedef struct {
+    char *arena;
+    size_t arena_size;
+    size_t arena_used;
+    size_t page_size;
+    uint64_t *page_stamps;      // access clock of the newest item use in each page
+    uint64_t clock;
+    KvSlot *slots;
+    uint32_t slot_mask;
+    KvClass classes[KV_CLASS_COUNT];
+
+    uint64_t items;
+    uint64_t bytes_used;
+    uint64_t evictions;
+    uint64_t page_reclaims;
+    uint64_t alloc_failures;
+} KvShard;
+
+/**
+ * Sharded in-memory key-value store with a fixed memory budget
+ */
+typedef struct {
+    KvShard *shards;
+    int shard_count;
+} KvStore;
+
+/**
+ * Allocate the arenas and hash tables of all shards
+ *
+ * @param store Store to initialize
+ * @param memory_limit Total arena size in bytes, split evenly between shards
+ * @param shard_count Number of shards
+ * @return 0 on success, -1 on error
+ */
+int kv_store_init(KvStore *store, size_t memory_limit, int shard_count);
+
+/**
+ * Release all memory of the store
+ *
+ * @param store Store to free
+ */
+void kv_store_free(KvStore *store);
+
+/**
+ * Look up a key and mark it as recently used
+ *
+ * @param store Store
+ * @param key Key bytes
+ * @param key_len Key length
+ * @param value Pointer to store the value location (valid until the next modification)
+ * @param value_len Pointer to store the value length
+ * @return 1 if found, 0 if not
+ */
+int kv_store_get(KvStore *store, const char *key, size_t key_len, const char **value, size_t *value_len);
+
+/**
+ * Insert or replace a key. When the shard arena is full, the size class
+ * whose CLOCK hand points at the least recently used page gives up memory:
+ * the new item's own class evicts one item, any other class hands over
+ * that whole page.
+ *
+ * @param store Store
+ * @param key Key bytes
+ * @param key_len Key length (at most KV_MAX_KEY)
+ * @param value Value bytes
+ * @param value_len Value length
+ * @return 0 on success, -1 if the item is too large or no memory can be freed
+ */
+int kv_store_set(KvStore *store, const char *key, size_t key_len, const char *value, size_t value_len);
+
+/**
+ * Remove a key
+ *
+ * @param store Store
+ * @param key Key bytes
+ * @param key_len Key length
+ * @return 1 if the key was removed, 0 if it did not exist
+ */
+int kv_store_delete(KvStore *store, const char *key, size_t key_len);
+
+#endif /* KV_STORE_H */
@@ -0,0 +1,338 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include "log_sink.h"
+#include "trace.h"
+
+static size_t round_up_block(size_t len) {
+    return (len + SINK_BLOCK_SIZE - 1) / SINK_BLOCK_SIZE * SINK_BLOCK_SIZE;
+}
+
+static int open_segment(LogSink *sink, uint64_t segment) {
+    char timestamp[32];
+    char path[512];
+    time_t now = time(NULL);
+    strftime(timestamp, sizeof(timestamp), "%Y%m%d-%H%M%S", localtime(&now));
+    snprintf(path, sizeof(path), "%s/%s-%s-%06llu.log", sink->directory, sink->prefix,
+             timestamp, (unsigned long long)segment);
+
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#ifdef O_DIRECT
+    if (sink->direct_io) {
+        int fd = open(path, flags | O_DIRECT, 0644);
+        if (fd >= 0 || errno != EINVAL) {
+            if (fd < 0) {
+                perror("Error opening log segment");
+            }
+            return fd;
+        }
+        // Some file systems (e.g. tmpfs) reject O_DIRECT; aligned writes still work without it
+        fprintf(stderr, "O_DIRECT not supported for %s, using buffered writes\n", path);
+    }
+#endif
+    int fd = open(path, flags, 0644);
+    if (fd < 0) {
+        perror("Error opening log segment");
+    }
+    return fd;
+}
+
+static void close_segment(LogSink *sink) {
+    if (sink->fd < 0) {
+        return;
+    }
+    if (sink->fsync_policy != SINK_FSYNC_NONE && fsync(sink->fd) < 0) {
+        perror("Error syncing log segment");
+    }
+    close(sink->fd);
+    sink->fd = -1;
+}
+
+// Write one run of contiguous buffers of the same segment
+static void write_group(LogSink *sink, SinkBuffer **group, int count) {
+    struct iovec iov[SINK_MAX_IOV];
+    size_t total = 0;
+    for (int i = 0; i < count; i++) {
+        iov[i].iov_base = group[i]->data;
+        iov[i].iov_len = group[i]->write_len;
+        total += group[i]->write_len;
+    }
+
+    uint64_t segment = group[0]->segment;
+    if (sink->open_segment != segment) {
+        close_segment(sink);
+        sink->fd = open_segment(sink, segment);
+        sink->open_segment = segment;
+        pthread_mutex_lock(&sink->lock);
+        sink->segments++;
+        pthread_mutex_unlock(&sink->lock);
+    }
+
+    // A short pwritev is resumed where it stopped so the segment has no holes
+    ssize_t written = -1;
+    if (sink->fd >= 0) {
+        struct iovec *pending = iov;
+        int remaining = count;
+        written = 0;
+        while ((size_t)written < total) {
+            ssize_t result = pwritev(sink->fd, pending, remaining, group[0]->offset + written);
+            if (result < 0 && errno == EINTR) {
+                continue;
+            }
+            if (result < 0) {
+                perror("Error writing log segment");
+                break;
+            }
+            if (result == 0) {
+                fprintf(stderr, "Error writing log segment: no progress\n");
+                break;
+            }
+            written += result;
+            while (remaining > 0 && (size_t)result >= pending->iov_len) {
+                result -= (ssize_t)pending->iov_len;
+                pending++;
+                remaining--;
+            }
+            if (remaining > 0) {
+                pending->iov_base = (char *)pending->iov_base + result;
+                pending->iov_len -= (size_t)result;
+            }
+        }
+    }
+
+    // Drop the zero padding of a partial direct-I/O block again
+    SinkBuffer *last = group[count - 1];
+    if (written > 0 && last->write_len != last->len &&
+        ftruncate(sink->fd, last->offset + (off_t)last->len) < 0) {
+        perror("Error truncating log segment");
+    }
+    if (written > 0 && sink->fsync_policy == SINK_FSYNC_ALWAYS && fdatasync(sink->fd) < 0) {
+        perror("Error syncing log segment");
+    }
+
+    pthread_mutex_lock(&sink->lock);
+    sink->writes++;
+    if (written == (ssize_t)total) {
+        for (int i = 0; i < count; i++) {
+            sink->bytes_written += group[i]->len - group[i]->carried;
+        }
+    } else {
+        sink->write_errors++;
+    }
+    for (int i = 0; i < count; i++) {
+        group[i]->next = sink->free_list;
+        sink->free_list = group[i];
+    }
+    pthread_mutex_unlock(&sink->lock);
+}
+
+static void *sink_writer(void *arg) {
+    LogSink *sink = arg;
+    trace_thread_start("log sink writer");
+
+    while (1) {
+        pthread_mutex_lock(&sink->lock);
+        while (!sink->queue_head && !sink->stopping) {
+            pthread_cond_wait(&sink->ready, &sink->lock);
+        }
+        SinkBuffer *batch = sink->queue_head;
+        sink->queue_head = NULL;
+        sink->queue_tail = NULL;
+        pthread_mutex_unlock(&sink->lock);
+
+        if (!batch) {
+            break;
+        }
+
+        while (batch) {
+            SinkBuffer *group[SINK_MAX_IOV];
+            int count = 0;
+            group[count++] = batch;
+            batch = batch->next;
+            while (batch && count < SINK_MAX_IOV && batch->segment == group[0]->segment &&
+                   batch->offset == group[count - 1]->offset + (off_t)group[count - 1]->write_len) {
+                group[count++] = batch;
+                batch = batch->next;
+            }
+            TRACE_SAMPLE();
+            TRACE_BEGIN(write_start);
+            write_group(sink, group, count);
+            TRACE_END(TRACE_SINK_WRITE, write_start);
+        }
+    }
+
+    close_segment(sink);
+    return NULL;
+}
+
+// Hand the current buffer to the writer thread
+static void queue_current(LogSink *sink) {
+    SinkBuffer *buffer = sink->current;
+    if (!buffer || buffer->len == buffer->carried) {
+        return;
+    }
+
+    buffer->write_len = buffer->len;
+    sink->tail_len = 0;
+    if (sink->direct_io) {
+        buffer->write_len = round_up_block(buffer->len);
+        memset(buffer->data + buffer->len, 0, buffer->write_len - buffer->len);
+        sink->tail_len = buffer->len % SINK_BLOCK_SIZE;
+        memcpy(sink->tail, buffer->data + buffer->len - sink->tail_len, sink->tail_len);
+    }
+
+    buffer->next = NULL;
+    pthread_mutex_lock(&sink->lock);
+    if (sink->queue_tail) {
+        sink->queue_tail->next = buffer;
+    } else {
+        sink->queue_head = buffer;
+    }
+    sink->queue_tail = buffer;
+    pthread_cond_signal(&sink->ready);
+    pthread_mutex_unlock(&sink->lock);
+
+    sink->current = NULL;
+}
+
+// Take a free buffer for the current segment; returns NULL if all buffers are queued
+static SinkBuffer *acquire_buffer(LogSink *sink) {
+    pthread_mutex_lock(&sink->lock);
+    SinkBuffer *buffer = sink->free_list;
+    if (buffer) {
+        sink->free_list = buffer->next;
+    }
+    pthread_mutex_unlock(&sink->lock);
+    if (!buffer) {
+        return NULL;
+    }
+
+    memcpy(buffer->data, sink->tail, sink->tail_len);
+    buffer->len = sink->tail_len;
+    buffer->carried = sink->tail_len;
+    buffer->offset = sink->segment_offset - (off_t)sink->tail_len;
+    buffer->segment = sink->segment;
+    return buffer;
+}
+
+static void rotate_segment(LogSink *sink, uint64_t now_ms) {
+    queue_current(sink);
+    sink->segment++;
+    sink->segment_offset = 0;
+    sink->segment_started_ms = now_ms;
+    sink->tail_len = 0;
+}
+
+int log_sink_init(LogSink *sink, const ServerConfig *config, uint64_t now_ms) {
+    memset(sink, 0, sizeof(LogSink));
+    snprintf(sink->directory, sizeof(sink->directory), "%s", config->syslog_directory);
+    snprintf(sink->prefix, sizeof(sink->prefix), "%s", config->syslog_prefix);
+    sink->buffer_size = round_up_block((size_t)config->syslog_buffer_kb * 1024);
+    sink->segment_bytes = (uint64_t)config->syslog_segment_mb * 1024 * 1024;
+    sink->segment_ms = (uint64_t)config->syslog_segment_seconds * 1000;
+    sink->flush_ms = (uint64_t)config->syslog_flush_interval_ms;
+    sink->direct_io = config->syslog_direct_io;
+    if (strcmp(config->syslog_fsync, "always") == 0) {
+        sink->fsync_policy = SINK_FSYNC_ALWAYS;
+    } else if (strcmp(config->syslog_fsync, "segment") == 0) {
+        sink->fsync_policy = SINK_FSYNC_SEGMENT;
+    } else {
+        sink->fsync_policy = SINK_FSYNC_NONE;
+    }
+    sink->fd = -1;
+    sink->segment = 1;
+    sink->segment_started_ms = now_ms;
+    sink->last_flush_ms = now_ms;
+    sink->now_ms = now_ms;
+
+    sink->buffer_count = config->syslog_buffer_count;
+    sink->buffers = calloc(sink->buffer_count, sizeof(SinkBuffer));
+    if (!sink->buffers) {
+        return -1;
+    }
+    for (int i = 0; i < sink->buffer_count; i++) {
+        void *data;
+        if (posix_memalign(&data, SINK_BLOCK_SIZE, sink->buffer_size) != 0) {
+            log_sink_free(sink);
+            return -1;
+        }
+        sink->buffers[i].data = data;
+        sink->buffers[i].next = sink->free_list;
+        sink->free_list = &sink->buffers[i];
+    }
+
+    pthread_mutex_init(&sink->lock, NULL);
+    pthread_cond_init(&sink->ready, NULL);
+    if (pthread_create(&sink->writer, NULL, sink_writer, sink) != 0) {
+        log_sink_free(sink);
+        return -1;
+    }
+    sink->writer_started = 1;
+    return 0;
+}
+
+int log_sink_append(LogSink *sink, const char *data, size_t len) {
+    // A buffer must hold the carried-over tail block plus the record
+    if (len > sink->buffer_size - SINK_BLOCK_SIZE) {
+        sink->dropped_records++;
+        return -1;
+    }
+
+    if (sink->segment_offset > 0 && (uint64_t)sink->segment_offset + len > sink->segment_bytes) {
+        rotate_segment(sink, sink->now_ms);
+    }
+    if (sink->current && sink->current->len + len > sink->buffer_size) {
+        queue_current(sink);
+    }
+    if (!sink->current) {
+        sink->current = acquire_buffer(sink);
+        if (!sink->current) {
+            sink->dropped_records++;
+            return -1;
+        }
+    }
+
+    memcpy(sink->current->data + sink->current->len, data, len);
+    sink->current->len += len;
+    sink->segment_offset += (off_t)len;
+    sink->appended_bytes += len;
+    return 0;
+}
+
+void log_sink_tick(LogSink *sink, uint64_t now_ms) {
+    sink->now_ms = now_ms;
+    if (now_ms - sink->last_flush_ms >= sink->flush_ms) {
+        queue_current(sink);
+        sink->last_flush_ms = now_ms;
+    }
+    if (sink->segment_ms > 0 && sink->segment_offset > 0 &&
+        now_ms - sink->segment_started_ms >= sink->segment_ms) {
+        rotate_segment(sink, now_ms);
+    }
+}
+
+void log_sink_free(LogSink *sink) {
+    if (sink->writer_started) {
+        queue_current(sink);
+        pthread_mutex_lock(&sink->lock);
+        sink->stopping = 1;
+        pthread_cond_signal(&sink->ready);
+        pthread_mutex_unlock(&sink->lock);
+        pthread_join(sink->writer, NULL);
+        pthread_mutex_destroy(&sink->lock);
+        pthread_cond_destroy(&sink->ready);
+        sink->writer_started = 0;
+    }
+    if (sink->buffers) {
+        for (int i = 0; i < sink->buffer_count; i++) {
+            free(sink->buffers[i].data);
+        }
+        free(sink->buffers);
+        sink->buffers = NULL;
+    }
+}
@@ -0,0 +1,126 @@
+#ifndef LOG_SINK_H
+#define LOG_SINK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include "udp_server.h"
+
+// Alignment of sink buffers, write sizes and offsets with O_DIRECT
+#define SINK_BLOCK_SIZE 4096
+// Buffers written by one pwritev call at most
+#define SINK_MAX_IOV 64
+
+/**
+ * When segment files are fsynced
+ */
+typedef enum {
+    SINK_FSYNC_NONE = 0,
+    SINK_FSYNC_SEGMENT,     // when a segment is closed
+    SINK_FSYNC_ALWAYS       // after every write
+} SinkFsyncPolicy;
+
+/**
+ * Aligned write buffer. offset is the position of data[0] in its segment;
+ * write_len is len rounded up to SINK_BLOCK_SIZE with O_DIRECT, and the
+ * first carried bytes repeat the tail block of the previous buffer.
+ */
+typedef struct SinkBuffer {
+    struct SinkBuffer *next;
+    char *data;
+    size_t len;
+    size_t write_len;
+    size_t carried;
+    off_t offset;
+    uint64_t segment;
+} SinkBuffer;
+
+/**
+ * Append-only segment writer. The receive loop fills the current buffer
+ * and queues it; a writer thread writes queued buffers with pwritev.
+ * The loop never waits for the disk: without a free buffer data is dropped.
+ */
+typedef struct {
+    char directory[256];
+    char prefix[64];
+    size_t buffer_size;
+    uint64_t segment_bytes;
+    uint64_t segment_ms;
+    uint64_t flush_ms;
+    SinkFsyncPolicy fsync_policy;
+    int direct_io;
+
+    SinkBuffer *buffers;
+    int buffer_count;
+    SinkBuffer *current;
+    // Last partial block of a direct-I/O segment; it starts the next buffer
+    // so every write begins at an aligned offset
+    char tail[SINK_BLOCK_SIZE];
+    size_t tail_len;
+    uint64_t segment;
+    off_t segment_offset;
+    uint64_t segment_started_ms;
+    uint64_t last_flush_ms;
+    // Loop time of the last tick; rotation in append uses it so segment ages never go negative
+    uint64_t now_ms;
+
+    pthread_t writer;
+    int writer_started;
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    SinkBuffer *free_list;
+    SinkBuffer *queue_head;
+    SinkBuffer *queue_tail;
+    int stopping;
+
+    // Written by the receive loop
+    uint64_t appended_bytes;
+    uint64_t dropped_records;
+
+    // Written by the writer thread under lock
+    int fd;
+    uint64_t open_segment;
+    uint64_t bytes_written;
+    uint64_t writes;
+    uint64_t segments;
+    uint64_t write_errors;
+} LogSink;
+
+/**
+ * Allocate the buffer pool and start the writer thread
+ *
+ * @param sink Sink to initialize
+ * @param config Server configuration (syslog section)
+ * @param now_ms Current monotonic time in milliseconds
+ * @return 0 on success, -1 on error
+ */
+int log_sink_init(LogSink *sink, const ServerConfig *config, uint64_t now_ms);
+
+/**
+ * Append one record, queueing the current buffer when it is full
+ *
+ * @param sink Sink
+ * @param data Record bytes
+ * @param len Record length (at most the buffer size)
+ * @return 0 on success, -1 if the record was dropped
+ */
+int log_sink_append(LogSink *sink, const char *data, size_t len);
+
+/**
+ * Queue the current buffer when the flush interval has passed and start a
+ * new segment when the current one is too old
+ *
+ * @param sink Sink
+ * @param now_ms Current monotonic time in milliseconds
+ */
+void log_sink_tick(LogSink *sink, uint64_t now_ms);
+
+/**
+ * Write all pending data, stop the writer thread and release the buffers
+ *
+ * @param sink Sink to free
+ */
+void log_sink_free(LogSink *sink);
+
+#endif /* LOG_SINK_H */
@@ -0,0 +1,208 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <jansson.h>
+#include "metrics.h"
+
+int write_metrics(const ServerMetrics *metrics, const char *path) {
+    json_t *root = json_object();
+
+    time_t now = time(NULL);
+    char timestamp[30];
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", localtime(&now));
+    json_object_set_new(root, "timestamp", json_string(timestamp));
+
+    json_object_set_new(root, "packets_received", json_integer(metrics->packets_received));
+    json_object_set_new(root, "packets_sent", json_integer(metrics->packets_sent));
+    json_object_set_new(root, "bytes_received", json_integer(metrics->bytes_received));
+    json_object_set_new(root, "bytes_sent", json_integer(metrics->bytes_sent));
+    json_object_set_new(root, "receive_errors", json_integer(metrics->receive_errors));
+    json_object_set_new(root, "send_errors", json_integer(metrics->send_errors));
+    json_object_set_new(root, "batches", json_integer(metrics->batches));
+
+    json_t *overload = json_object();
+    json_object_set_new(overload, "level", json_integer(metrics->overload_level));
+    json_object_set_new(overload, "level_name",
+                        json_string(metrics->overload_level_name ? metrics->overload_level_name : "normal"));
+    json_object_set_new(overload, "transitions", json_integer(metrics->overload_transitions));
+    json_object_set_new(overload, "pressure", json_real(metrics->overload_pressure));
+    json_object_set_new(overload, "kernel_drops", json_integer(metrics->kernel_drops));
+    json_object_set_new(overload, "queue_delay_us", json_real(metrics->queue_delay_us));
+    json_object_set_new(overload, "batch_fill", json_real(metrics->batch_fill));
+    json_object_set_new(overload, "busy_replies", json_integer(metrics->busy_replies));
+    json_object_set_new(overload, "shed_packets", json_integer(metrics->shed_packets));
+    json_object_set_new(root, "overload", overload);
+
+    json_t *pending = json_object();
+    json_object_set_new(pending, "in_flight", json_integer(metrics->pending_in_flight));
+    json_object_set_new(pending, "started", json_integer(metrics->pending_started));
+    json_object_set_new(pending, "completed", json_integer(metrics->pending_completed));
+    json_object_set_new(pending, "timed_out", json_integer(metrics->pending_timed_out));
+    json_object_set_new(pending, "rejected", json_integer(metrics->pending_rejected));
+    json_object_set_new(pending, "stale_completions", json_integer(metrics->pending_stale));
+    json_object_set_new(root, "pending", pending);
+
+    if (metrics->proxy_enabled) {
+        json_t *proxy = json_object();
+        json_object_set_new(proxy, "flows_active", json_integer(metrics->proxy_flows_active));
+        json_object_set_new(proxy, "flows_created", json_integer(metrics->proxy_flows_created));
+        json_object_set_new(proxy, "flows_expired", json_integer(metrics->proxy_flows_expired));
+        json_object_set_new(proxy, "flow_failures", json_integer(metrics->proxy_flow_failures));
+        json_object_set_new(proxy, "no_backend_drops", json_integer(metrics->proxy_no_backend));
+        json_object_set_new(proxy, "forwarded", json_integer(metrics->proxy_forwarded));
+        json_object_set_new(proxy, "relayed", json_integer(metrics->proxy_relayed));
+
+        json_t *backends = json_array();
+        for (int i = 0; i < metrics->proxy_backend_count; i++) {
+            const BackendMetrics *backend = &metrics->proxy_backends[i];
+            json_t *entry = json_object();
+            json_object_set_new(entry, "address", json_string(backend->name));
+            json_object_set_new(entry, "healthy", json_boolean(backend->healthy));
+            json_object_set_new(entry, "outstanding", json_integer(backend->outstanding));
+            json_object_set_new(entry, "forwarded", json_integer(backend->forwarded));
+            json_object_set_new(entry, "relayed", json_integer(backend->relayed));
+            json_array_append_new(backends, entry);
+        }
+        json_object_set_new(proxy, "backends", backends);
+        json_object_set_new(root, "proxy", proxy);
+    }
+
+    if (metrics->echo_enabled) {
+        json_t *echo = json_object();
+        json_object_set_new(echo, "stamp", json_string(metrics->echo_stamp ? metrics->echo_stamp : "none"));
+        json_object_set_new(echo, "stamp_offset", json_integer(metrics->echo_stamp_offset));
+        json_object_set_new(echo, "stamped", json_integer(metrics->echo_stamped));
+        json_object_set_new(echo, "too_short", json_integer(metrics->echo_too_short));
+        json_object_set_new(root, "echo", echo);
+    }
+
+    if (metrics->filter_enabled) {
+        json_t *filters = json_object();
+        json_object_set_new(filters, "implementation",
+                            json_string(metrics->filter_impl ? metrics->filter_impl : "scalar"));
+        json_object_set_new(filters, "dropped", json_integer(metrics->filter_dropped));
+        json_object_set_new(filters, "routed", json_integer(metrics->filter_routed));
+        json_object_set_new(filters, "tagged", json_integer(metrics->filter_tagged));
+        json_t *rules = json_array();
+        for (int i = 0; i < metrics->filter_rule_count; i++) {
+            json_t *entry = json_object();
+            json_object_set_new(entry, "rule", json_string(metrics->filter_rules[i].rule));
+            json_object_set_new(entry, "hits", json_integer(metrics->filter_rules[i].hits));
+            json_array_append_new(rules, entry);
+        }
+        json_object_set_new(filters, "rules", rules);
+        json_object_set_new(root, "filters", filters);
+    }
+
+    if (metrics->auth_enabled) {
+        json_t *auth = json_object();
+        json_object_set_new(auth, "implementation",
+                            json_string(metrics->auth_impl ? metrics->auth_impl : "generic"));
+        json_object_set_new(auth, "keys", json_integer(metrics->auth_keys));
+        json_object_set_new(auth, "verified", json_integer(metrics->auth_verified));
+        json_object_set_new(auth, "malformed", json_integer(metrics->auth_malformed));
+        json_object_set_new(auth, "unknown_key", json_integer(metrics->auth_unknown_key));
+        json_object_set_new(auth, "bad_tag", json_integer(metrics->auth_bad_tag));
+        json_object_set_new(auth, "reloads", json_integer(metrics->auth_reloads));
+        json_object_set_new(root, "auth", auth);
+    }
+
+    if (metrics->pubsub_enabled) {
+        json_t *pubsub = json_object();
+        json_object_set_new(pubsub, "topics", json_integer(metrics->pubsub_topics));
+        json_object_set_new(pubsub, "subscriptions", json_integer(metrics->pubsub_subscriptions));
+        json_object_set_new(pubsub, "expired_leases", json_integer(metrics->pubsub_expired));
+        json_object_set_new(pubsub, "publishes", json_integer(metrics->pubsub_publishes));
+        json_object_set_new(pubsub, "deliveries", json_integer(metrics->pubsub_deliveries));
+        json_object_set_new(pubsub, "fanout_drops", json_integer(metrics->pubsub_fanout_drops));
+        json_object_set_new(pubsub, "fanout_cpu_seconds", json_real(metrics->pubsub_fanout_cpu_seconds));
+        json_object_set_new(pubsub, "deliveries_per_core_second",
+                            json_real(metrics->pubsub_deliveries_per_core_second));
+        json_object_set_new(root, "pubsub", pubsub);
+    }
+
+    if (metrics->kv_enabled) {
+        json_t *kv = json_object();
+        json_object_set_new(kv, "items", json_integer(metrics->kv_items));
+        json_object_set_new(kv, "bytes_used", json_integer(metrics->kv_bytes_used));
+        json_object_set_new(kv, "arena_used", json_integer(metrics->kv_arena_used));
+        json_object_set_new(kv, "evictions", json_integer(metrics->kv_evictions));
+        json_object_set_new(kv, "page_reclaims", json_integer(metrics->kv_page_reclaims));
+        json_object_set_new(kv, "alloc_failures", json_integer(metrics->kv_alloc_failures));
+        json_object_set_new(kv, "gets", json_integer(metrics->kv_gets));
+        json_object_set_new(kv, "hits", json_integer(metrics->kv_hits));
+        json_object_set_new(kv, "sets", json_integer(metrics->kv_sets));
+        json_object_set_new(kv, "deletes", json_integer(metrics->kv_deletes));
+        json_object_set_new(kv, "bad_requests", json_integer(metrics->kv_bad_requests));
+        json_object_set_new(root, "kv", kv);
+    }
+
+    if (metrics->statsd_enabled) {
+        json_t *statsd = json_object();
+        json_object_set_new(statsd, "lines", json_integer(metrics->statsd_lines));
+        json_object_set_new(statsd, "bad_lines", json_integer(metrics->statsd_bad_lines));
+        json_object_set_new(statsd, "metrics", json_integer(metrics->statsd_metrics));
+        json_object_set_new(statsd, "dropped_samples", json_integer(metrics->statsd_dropped));
+        json_object_set_new(statsd, "flushes", json_integer(metrics->statsd_flushes));
+        json_object_set_new(statsd, "rows_written", json_integer(metrics->statsd_rows));
+        json_object_set_new(root, "statsd", statsd);
+    }
+
+    if (metrics->syslog_enabled) {
+        json_t *syslog = json_object();
+        json_object_set_new(syslog, "messages", json_integer(metrics->syslog_messages));
+        json_object_set_new(syslog, "rfc5424", json_integer(metrics->syslog_rfc5424));
+        json_object_set_new(syslog, "rfc3164", json_integer(metrics->syslog_rfc3164));
+        json_object_set_new(syslog, "raw", json_integer(metrics->syslog_raw));
+        json_object_set_new(syslog, "dropped", json_integer(metrics->syslog_dropped));
+        json_object_set_new(syslog, "appended_bytes", json_integer(metrics->syslog_appended_bytes));
+        json_object_set_new(syslog, "bytes_written", json_integer(metrics->syslog_bytes_written));
+        json_object_set_new(syslog, "writes", json_integer(metrics->syslog_writes));
+        json_object_set_new(syslog, "segments", json_integer(metrics->syslog_segments));
+        json_object_set_new(syslog, "write_errors", json_integer(metrics->syslog_write_errors));
+        json_object_set_new(root, "syslog", syslog);
+    }
+
+    if (metrics->trace_enabled) {
+        json_t *trace = json_object();
+        json_t *stages = json_object();
+        json_object_set_new(trace, "sample_every", json_integer(metrics->trace_sample_every));
+        for (int i = 0; i < TRACE_STAGE_COUNT; i++) {
+            const TraceStageMetrics *stage = &metrics->trace_stages[i];
+            if (stage->spans == 0) {
+                continue;
+            }
+            json_t *entry = json_object();
+            json_object_set_new(entry, "spans", json_integer(stage->spans));
+            json_object_set_new(entry, "total_ms", json_real(stage->total_ms));
+            json_object_set_new(entry, "avg_ns", json_real(stage->avg_ns));
+            json_object_set_new(entry, "max_ns", json_real(stage->max_ns));
+            json_object_set_new(stages, stage->name, entry);
+        }
+        json_object_set_new(trace, "stages", stages);
+        json_object_set_new(root, "trace", trace);
+    }
+
+    char *json_str = json_dumps(root, JSON_INDENT(2));
+    json_decref(root);
+    if (!json_str) {
+        return -1;
+    }
+
+    char tmp_path[512];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE *fp = fopen(tmp_path, "w");
+    if (!fp) {
+        free(json_str);
+        return -1;
+    }
+    fprintf(fp, "%s\n", json_str);
+    free(json_str);
+
+    if (fclose(fp) != 0 || rename(tmp_path, path) != 0) {
+        remove(tmp_path);
+        return -1;
+    }
+    return 0;
+}
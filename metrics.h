@@ -0,0 +1,171 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include "udp_server.h"
+#include "trace.h"
+
+/**
+ * Hits of one payload filter rule
+ */
+typedef struct {
+    char rule[MAX_RULE_LENGTH + 8];
+    uint64_t hits;
+} FilterRuleMetrics;
+
+/**
+ * Per-backend proxy counters
+ */
+typedef struct {
+    char name[MAX_RULE_LENGTH];
+    int healthy;
+    uint64_t outstanding;
+    uint64_t forwarded;
+    uint64_t relayed;
+} BackendMetrics;
+
+/**
+ * Sampled cost of one processing stage
+ */
+typedef struct {
+    const char *name;
+    uint64_t spans;
+    double total_ms;
+    double avg_ns;
+    double max_ns;
+} TraceStageMetrics;
+
+/**
+ * Server counters and gauges, written periodically as a JSON snapshot
+ */
+typedef struct {
+    uint64_t packets_received;
+    uint64_t packets_sent;
+    uint64_t bytes_received;
+    uint64_t bytes_sent;
+    uint64_t receive_errors;
+    uint64_t send_errors;
+    uint64_t batches;
+
+    // Overload protection
+    uint64_t kernel_drops;
+    uint64_t busy_replies;
+    uint64_t shed_packets;
+    uint64_t overload_transitions;
+    int overload_level;
+    const char *overload_level_name;
+    double overload_pressure;
+    double queue_delay_us;
+    double batch_fill;
+
+    // Deferred requests
+    uint64_t pending_in_flight;
+    uint64_t pending_started;
+    uint64_t pending_completed;
+    uint64_t pending_timed_out;
+    uint64_t pending_rejected;
+    uint64_t pending_stale;
+
+    // Proxy mode
+    int proxy_enabled;
+    uint64_t proxy_flows_active;
+    uint64_t proxy_flows_created;
+    uint64_t proxy_flows_expired;
+    uint64_t proxy_flow_failures;
+    uint64_t proxy_no_backend;
+    uint64_t proxy_forwarded;
+    uint64_t proxy_relayed;
+    int proxy_backend_count;
+    BackendMetrics proxy_backends[MAX_PROXY_BACKENDS];
+
+    // Echo mode
+    int echo_enabled;
+    const char *echo_stamp;
+    int echo_stamp_offset;
+    uint64_t echo_stamped;
+    uint64_t echo_too_short;
+
+    // Payload filters
+    int filter_enabled;
+    const char *filter_impl;
+    uint64_t filter_dropped;
+    uint64_t filter_routed;
+    uint64_t filter_tagged;
+    int filter_rule_count;
+    FilterRuleMetrics filter_rules[MAX_FILTER_RULES];
+
+    // Datagram authentication
+    int auth_enabled;
+    const char *auth_impl;
+    int auth_keys;
+    uint64_t auth_verified;
+    uint64_t auth_malformed;
+    uint64_t auth_unknown_key;
+    uint64_t auth_bad_tag;
+    uint64_t auth_reloads;
+
+    // Pub/sub handler
+    int pubsub_enabled;
+    uint64_t pubsub_topics;
+    uint64_t pubsub_subscriptions;
+    uint64_t pubsub_expired;
+    uint64_t pubsub_publishes;
+    uint64_t pubsub_deliveries;
+    uint64_t pubsub_fanout_drops;
+    double pubsub_fanout_cpu_seconds;
+    double pubsub_deliveries_per_core_second;
+
+    // Key-value handler
+    int kv_enabled;
+    uint64_t kv_items;
+    uint64_t kv_bytes_used;
+    uint64_t kv_arena_used;
+    uint64_t kv_evictions;
+    uint64_t kv_page_reclaims;
+    uint64_t kv_alloc_failures;
+    uint64_t kv_gets;
+    uint64_t kv_hits;
+    uint64_t kv_sets;
+    uint64_t kv_deletes;
+    uint64_t kv_bad_requests;
+
+    // StatsD ingestion
+    int statsd_enabled;
+    uint64_t statsd_lines;
+    uint64_t statsd_bad_lines;
+    uint64_t statsd_metrics;
+    uint64_t statsd_dropped;
+    uint64_t statsd_flushes;
+    uint64_t statsd_rows;
+
+    // Syslog sink
+    int syslog_enabled;
+    uint64_t syslog_messages;
+    uint64_t syslog_rfc5424;
+    uint64_t syslog_rfc3164;
+    uint64_t syslog_raw;
+    uint64_t syslog_dropped;
+    uint64_t syslog_appended_bytes;
+    uint64_t syslog_bytes_written;
+    uint64_t syslog_writes;
+    uint64_t syslog_segments;
+    uint64_t syslog_write_errors;
+
+    // Stage tracing
+    int trace_enabled;
+    int trace_sample_every;
+    TraceStageMetrics trace_stages[TRACE_STAGE_COUNT];
+} ServerMetrics;
+
+/**
+ * Write a metrics snapshot to a file.
+ * The snapshot is written to a temporary file and renamed into place,
+ * so readers never see a partially written file.
+ *
+ * @param metrics Metrics to write
+ * @param path Destination file path
+ * @return 0 on success, -1 on error
+ */
+int write_metrics(const ServerMetrics *metrics, const char *path);
+
+#endif /* METRICS_H */
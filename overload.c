@@ -0,0 +1,179 @@
+#include "overload.h"
+
+static const char *level_names[OVERLOAD_LEVEL_COUNT] = {
+    "normal",
+    "no_payload_log",
+    "busy_reply",
+    "shed"
+};
+
+// Parse "a.b.c.d" or "a.b.c.d/len" into network and mask
+static int parse_cidr(const char *rule, OverloadCidr *cidr) {
+    char address[MAX_RULE_LENGTH];
+    int prefix_len = 32;
+
+    strncpy(address, rule, sizeof(address) - 1);
+    address[sizeof(address) - 1] = '\0';
+
+    char *slash = strchr(address, '/');
+    if (slash) {
+        *slash = '\0';
+        char *end;
+        long parsed = strtol(slash + 1, &end, 10);
+        if (end == slash + 1 || *end != '\0' || parsed < 0 || parsed > 32) {
+            return -1;
+        }
+        prefix_len = (int)parsed;
+    }
+
+    struct in_addr addr;
+    if (inet_pton(AF_INET, address, &addr) != 1) {
+        return -1;
+    }
+
+    cidr->mask = prefix_len == 0 ? 0 : htonl(0xFFFFFFFFu << (32 - prefix_len));
+    cidr->network = addr.s_addr & cidr->mask;
+    return 0;
+}
+
+int overload_init(OverloadController *oc, const ServerConfig *config, uint64_t now_ms) {
+    int result = 0;
+
+    memset(oc, 0, sizeof(*oc));
+    oc->enabled = config->overload_enabled;
+    oc->interval_ms = config->overload_interval_ms;
+    oc->hold_ms = config->overload_hold_ms;
+    oc->drop_threshold = config->overload_drop_threshold;
+    oc->delay_threshold_us = config->overload_delay_threshold_us;
+    oc->fill_threshold = config->overload_fill_threshold;
+    oc->hysteresis = config->overload_hysteresis;
+    oc->level = OVERLOAD_NORMAL;
+    oc->interval_start_ms = now_ms;
+    oc->level_since_ms = now_ms;
+
+    for (int i = 0; i < config->low_priority_client_count; i++) {
+        if (parse_cidr(config->low_priority_clients[i], &oc->clients[oc->client_count]) < 0) {
+            fprintf(stderr, "Ignoring invalid low priority client rule: %s\n",
+                    config->low_priority_clients[i]);
+            result = -1;
+            continue;
+        }
+        oc->client_count++;
+    }
+
+    for (int i = 0; i < config->low_priority_prefix_count; i++) {
+        size_t len = strlen(config->low_priority_prefixes[i]);
+        if (len == 0) {
+            continue;
+        }
+        memcpy(oc->prefixes[oc->prefix_count], config->low_priority_prefixes[i], len + 1);
+        oc->prefix_lengths[oc->prefix_count] = len;
+        oc->prefix_count++;
+    }
+
+    return result;
+}
+
+void overload_observe_batch(OverloadController *oc, unsigned int received, unsigned int capacity,
+                            uint32_t drop_counter, int have_drop_counter, double queue_delay_us) {
+    if (!oc->enabled || received == 0) {
+        return;
+    }
+
+    // SO_RXQ_OVFL carries the socket's cumulative drop count; only the delta matters
+    if (have_drop_counter) {
+        if (oc->have_drop_counter && drop_counter >= oc->last_drop_counter) {
+            oc->interval_drops += drop_counter - oc->last_drop_counter;
+        } else if (!oc->have_drop_counter) {
+            oc->interval_drops += drop_counter;
+        }
+        oc->last_drop_counter = drop_counter;
+        oc->have_drop_counter = 1;
+    }
+
+    if (queue_delay_us > oc->interval_max_delay_us) {
+        oc->interval_max_delay_us = queue_delay_us;
+    }
+
+    oc->interval_fill_sum += (double)received / (double)capacity;
+    oc->interval_batches++;
+}
+
+// Ratio of a signal to its threshold; a threshold of 0 disables the signal
+static double signal_ratio(double value, double threshold) {
+    return threshold > 0.0 ? value / threshold : 0.0;
+}
+
+int overload_evaluate(OverloadController *oc, uint64_t now_ms) {
+    if (!oc->enabled || now_ms - oc->interval_start_ms < (uint64_t)oc->interval_ms) {
+        return 0;
+    }
+
+    oc->last_drops = (double)oc->interval_drops;
+    oc->last_delay_us = oc->interval_max_delay_us;
+    oc->last_fill = oc->interval_batches > 0 ? oc->interval_fill_sum / oc->interval_batches : 0.0;
+
+    double pressure = signal_ratio(oc->last_drops, oc->drop_threshold);
+    double ratio = signal_ratio(oc->last_delay_us, oc->delay_threshold_us);
+    if (ratio > pressure) {
+        pressure = ratio;
+    }
+    ratio = signal_ratio(oc->last_fill, oc->fill_threshold);
+    if (ratio > pressure) {
+        pressure = ratio;
+    }
+    oc->pressure = pressure;
+
+    oc->interval_start_ms = now_ms;
+    oc->interval_drops = 0;
+    oc->interval_max_delay_us = 0.0;
+    oc->interval_fill_sum = 0.0;
+    oc->interval_batches = 0;
+
+    // Escalate one level per interval while any signal is over its threshold;
+    // step back down only once all signals stay under threshold * hysteresis
+    OverloadLevel next = oc->level;
+    if (pressure >= 1.0 && oc->level < OVERLOAD_SHED) {
+        next = oc->level + 1;
+    } else if (pressure < oc->hysteresis && oc->level > OVERLOAD_NORMAL &&
+               now_ms - oc->level_since_ms >= (uint64_t)oc->hold_ms) {
+        next = oc->level - 1;
+    } else if (pressure >= oc->hysteresis) {
+        // Still hot: restart the hold time so recovery needs a calm streak
+        oc->level_since_ms = now_ms;
+    }
+
+    if (next == oc->level) {
+        return 0;
+    }
+
+    oc->level = next;
+    oc->level_since_ms = now_ms;
+    oc->transitions++;
+    return 1;
+}
+
+int overload_is_low_priority(const OverloadController *oc, const struct sockaddr_in *addr,
+                             const char *payload, size_t len) {
+    for (int i = 0; i < oc->client_count; i++) {
+        if ((addr->sin_addr.s_addr & oc->clients[i].mask) == oc->clients[i].network) {
+            return 1;
+        }
+    }
+
+    for (int i = 0; i < oc->prefix_count; i++) {
+        if (len >= oc->prefix_lengths[i] &&
+            memcmp(payload, oc->prefixes[i], oc->prefix_lengths[i]) == 0) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+const char *overload_level_name(OverloadLevel level) {
+    if (level < 0 || level >= OVERLOAD_LEVEL_COUNT) {
+        return "unknown";
+    }
+    return level_names[level];
+}
@@ -0,0 +1,119 @@
+#ifndef OVERLOAD_H
+#define OVERLOAD_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <netinet/in.h>
+#include "udp_server.h"
+
+/**
+ * Overload levels, each one including the actions of the levels below it
+ */
+typedef enum {
+    OVERLOAD_NORMAL = 0,        // full processing
+    OVERLOAD_NO_PAYLOAD_LOG,    // stop logging per-datagram payloads
+    OVERLOAD_BUSY_REPLY,        // answer with the cheap busy message
+    OVERLOAD_SHED,              // drop low-priority clients and prefixes
+    OVERLOAD_LEVEL_COUNT
+} OverloadLevel;
+
+/**
+ * IPv4 network parsed from an "a.b.c.d/len" rule
+ */
+typedef struct {
+    uint32_t network;
+    uint32_t mask;
+} OverloadCidr;
+
+/**
+ * Overload controller state.
+ * Signals are accumulated per batch and evaluated once per interval.
+ */
+typedef struct {
+    int enabled;
+    int interval_ms;
+    int hold_ms;
+    double drop_threshold;
+    double delay_threshold_us;
+    double fill_threshold;
+    double hysteresis;
+
+    OverloadCidr clients[MAX_PRIORITY_RULES];
+    int client_count;
+    char prefixes[MAX_PRIORITY_RULES][MAX_RULE_LENGTH];
+    size_t prefix_lengths[MAX_PRIORITY_RULES];
+    int prefix_count;
+
+    OverloadLevel level;
+    uint64_t interval_start_ms;
+    uint64_t level_since_ms;
+    uint64_t transitions;
+
+    // Signals of the current interval
+    uint32_t last_drop_counter;
+    int have_drop_counter;
+    uint64_t interval_drops;
+    double interval_max_delay_us;
+    double interval_fill_sum;
+    unsigned int interval_batches;
+
+    // Result of the last evaluation
+    double last_drops;
+    double last_delay_us;
+    double last_fill;
+    double pressure;
+} OverloadController;
+
+/**
+ * Initialize the controller from configuration
+ *
+ * @param oc Controller to initialize
+ * @param config Server configuration
+ * @param now_ms Current monotonic time in milliseconds
+ * @return 0 on success, -1 if a low-priority rule could not be parsed
+ */
+int overload_init(OverloadController *oc, const ServerConfig *config, uint64_t now_ms);
+
+/**
+ * Record the signals of one received batch
+ *
+ * @param oc Overload controller
+ * @param received Number of datagrams returned by recvmmsg
+ * @param capacity Number of slots in the batch
+ * @param drop_counter Cumulative SO_RXQ_OVFL counter seen in the batch
+ * @param have_drop_counter Non-zero if drop_counter is valid
+ * @param queue_delay_us Largest kernel-to-user queueing delay in the batch
+ */
+void overload_observe_batch(OverloadController *oc, unsigned int received, unsigned int capacity,
+                            uint32_t drop_counter, int have_drop_counter, double queue_delay_us);
+
+/**
+ * Evaluate the signals of the finished interval and move at most one level
+ *
+ * @param oc Overload controller
+ * @param now_ms Current monotonic time in milliseconds
+ * @return 1 if the level changed, 0 otherwise
+ */
+int overload_evaluate(OverloadController *oc, uint64_t now_ms);
+
+/**
+ * Check whether a datagram belongs to low-priority traffic
+ *
+ * @param oc Overload controller
+ * @param addr Source address
+ * @param payload Datagram payload
+ * @param len Payload length
+ * @return 1 if the datagram matches a low-priority client or prefix rule
+ */
+int overload_is_low_priority(const OverloadController *oc, const struct sockaddr_in *addr,
+                             const char *payload, size_t len);
+
+/**
+ * Get a printable name for an overload level
+ *
+ * @param level Overload level
+ * @return Static level name
+ */
+const char *overload_level_name(OverloadLevel level);
+
+#endif /* OVERLOAD_H */
@@ -0,0 +1,218 @@
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include "pending.h"
+
+#define PENDING_NONE UINT32_MAX
+
+int pending_table_init(PendingTable *table, uint32_t capacity, uint64_t now_ms) {
+    memset(table, 0, sizeof(*table));
+    table->wake_fds[0] = -1;
+    table->wake_fds[1] = -1;
+
+    table->slots = calloc(capacity, sizeof(PendingSlot));
+    if (!table->slots) {
+        return -1;
+    }
+    table->capacity = capacity;
+
+    // Thread every slot onto the free list
+    for (uint32_t i = 0; i < capacity; i++) {
+        table->slots[i].next_free = i + 1 < capacity ? i + 1 : PENDING_NONE;
+    }
+    table->free_head = capacity > 0 ? 0 : PENDING_NONE;
+
+    timer_wheel_init(&table->wheel, now_ms);
+
+    if (pipe(table->wake_fds) < 0) {
+        free(table->slots);
+        table->slots = NULL;
+        return -1;
+    }
+    for (int i = 0; i < 2; i++) {
+        fcntl(table->wake_fds[i], F_SETFL, fcntl(table->wake_fds[i], F_GETFL) | O_NONBLOCK);
+    }
+
+    pthread_mutex_init(&table->lock, NULL);
+    return 0;
+}
+
+void pending_table_free(PendingTable *table) {
+    PendingCompletion *completion = table->completions;
+    while (completion) {
+        PendingCompletion *next = completion->next;
+        free(completion);
+        completion = next;
+    }
+
+    if (table->slots) {
+        pthread_mutex_destroy(&table->lock);
+    }
+    for (int i = 0; i < 2; i++) {
+        if (table->wake_fds[i] >= 0) {
+            close(table->wake_fds[i]);
+        }
+    }
+    free(table->slots);
+    memset(table, 0, sizeof(*table));
+}
+
+int pending_begin(PendingTable *table, const struct sockaddr_in *client,
+                  PendingContinuation continuation, void *user_data,
+                  uint32_t timeout_ms, PendingToken *token) {
+    if (table->free_head == PENDING_NONE) {
+        table->rejected++;
+        return -1;
+    }
+
+    uint32_t index = table->free_head;
+    PendingSlot *slot = &table->slots[index];
+    table->free_head = slot->next_free;
+
+    slot->in_use = 1;
+    slot->client = *client;
+    slot->continuation = continuation;
+    slot->user_data = user_data;
+    timer_wheel_add(&table->wheel, &slot->timer, table->wheel.now + timeout_ms);
+
+    table->in_flight++;
+    table->started++;
+    token->index = index;
+    token->generation = slot->generation;
+    return 0;
+}
+
+// Return a slot to the free list; bumping the generation invalidates old tokens
+static void release_slot(PendingTable *table, uint32_t index) {
+    PendingSlot *slot = &table->slots[index];
+    timer_wheel_remove(&table->wheel, &slot->timer);
+    slot->in_use = 0;
+    slot->generation++;
+    slot->continuation = NULL;
+    slot->user_data = NULL;
+    slot->next_free = table->free_head;
+    table->free_head = index;
+    table->in_flight--;
+}
+
+int pending_complete(PendingTable *table, PendingToken token, const void *result, size_t len) {
+    PendingCompletion *completion = malloc(sizeof(PendingCompletion) + len);
+    if (!completion) {
+        return -1;
+    }
+    completion->token = token;
+    completion->len = len;
+    if (len > 0) {
+        memcpy(completion->data, result, len);
+    }
+
+    pthread_mutex_lock(&table->lock);
+    int was_empty = table->completions == NULL;
+    completion->next = table->completions;
+    table->completions = completion;
+    pthread_mutex_unlock(&table->lock);
+
+    // One wake-up byte per empty->non-empty transition keeps the pipe from filling
+    if (was_empty) {
+        char byte = 1;
+        while (write(table->wake_fds[1], &byte, 1) < 0 && errno == EINTR) {
+        }
+    }
+    return 0;
+}
+
+int pending_wake_fd(const PendingTable *table) {
+    return table->wake_fds[0];
+}
+
+// Build the reply for a finished slot and release it
+static void finish_slot(PendingTable *table, uint32_t index, const char *result, size_t result_len,
+                        const char *fallback, char *scratch, size_t scratch_size,
+                        PendingReplyFn reply, void *arg) {
+    PendingSlot *slot = &table->slots[index];
+    struct sockaddr_in client = slot->client;
+    const char *response = result;
+    size_t response_len = result_len;
+
+    if (slot->continuation) {
+        response_len = slot->continuation(slot->user_data, result, result_len, scratch, scratch_size);
+        response = scratch;
+    }
+    if (response_len == 0 && fallback) {
+        response = fallback;
+        response_len = strlen(fallback);
+    }
+
+    release_slot(table, index);
+    if (response && response_len > 0) {
+        reply(arg, &client, response, response_len);
+    }
+}
+
+size_t pending_drain(PendingTable *table, char *scratch, size_t scratch_size,
+                     PendingReplyFn reply, void *arg) {
+    char bytes[64];
+    while (read(table->wake_fds[0], bytes, sizeof(bytes)) > 0) {
+    }
+
+    pthread_mutex_lock(&table->lock);
+    PendingCompletion *completion = table->completions;
+    table->completions = NULL;
+    pthread_mutex_unlock(&table->lock);
+
+    // The queue is LIFO; reverse it so replies go out in completion order
+    PendingCompletion *ordered = NULL;
+    while (completion) {
+        PendingCompletion *next = completion->next;
+        completion->next = ordered;
+        ordered = completion;
+        completion = next;
+    }
+
+    size_t completed = 0;
+    while (ordered) {
+        PendingCompletion *next = ordered->next;
+        PendingToken token = ordered->token;
+
+        if (token.index < table->capacity && table->slots[token.index].in_use &&
+            table->slots[token.index].generation == token.generation) {
+            finish_slot(table, token.index, ordered->data, ordered->len, NULL,
+                        scratch, scratch_size, reply, arg);
+            table->completed++;
+            completed++;
+        } else {
+            table->stale++;
+        }
+
+        free(ordered);
+        ordered = next;
+    }
+    return completed;
+}
+
+typedef struct {
+    PendingTable *table;
+    const char *fallback;
+    char *scratch;
+    size_t scratch_size;
+    PendingReplyFn reply;
+    void *arg;
+} ExpireContext;
+
+static void expire_slot(TimerNode *node, void *arg) {
+    ExpireContext *ctx = arg;
+    PendingSlot *slot = (PendingSlot *)node;
+    uint32_t index = (uint32_t)(slot - ctx->table->slots);
+
+    finish_slot(ctx->table, index, NULL, 0, ctx->fallback,
+                ctx->scratch, ctx->scratch_size, ctx->reply, ctx->arg);
+    ctx->table->timed_out++;
+}
+
+size_t pending_expire(PendingTable *table, uint64_t now_ms, const char *fallback,
+                      char *scratch, size_t scratch_size, PendingReplyFn reply, void *arg) {
+    ExpireContext ctx = { table, fallback, scratch, scratch_size, reply, arg };
+    return timer_wheel_advance(&table->wheel, now_ms, expire_slot, &ctx);
+}
@@ -0,0 +1,172 @@
+#ifndef PENDING_H
+#define PENDING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <netinet/in.h>
+#include "timer_wheel.h"
+
+/**
+ * Handle for a deferred request, safe to pass to other threads.
+ * The generation makes tokens of recycled slots stale.
+ */
+typedef struct {
+    uint32_t index;
+    uint32_t generation;
+} PendingToken;
+
+/**
+ * Continuation run on the receive loop when a deferred request finishes.
+ * On timeout it is called with result == NULL.
+ * It is called exactly once, so it may release user_data.
+ *
+ * @param user_data Pointer passed to pending_begin
+ * @param result Completion data, or NULL on timeout
+ * @param result_len Length of the completion data
+ * @param response Buffer for the reply
+ * @param response_size Size of the reply buffer
+ * @return Reply length; 0 selects the configured fallback on timeout and sends nothing otherwise
+ */
+typedef size_t (*PendingContinuation)(void *user_data, const char *result, size_t result_len,
+                                      char *response, size_t response_size);
+
+/**
+ * Slab slot of one deferred request; the timer node comes first
+ * so an expired TimerNode can be cast back to its slot
+ */
+typedef struct {
+    TimerNode timer;
+    uint32_t generation;
+    uint32_t next_free;
+    int in_use;
+    struct sockaddr_in client;
+    PendingContinuation continuation;
+    void *user_data;
+} PendingSlot;
+
+/**
+ * Completion handed over from another thread
+ */
+typedef struct PendingCompletion {
+    struct PendingCompletion *next;
+    PendingToken token;
+    size_t len;
+    char data[];
+} PendingCompletion;
+
+/**
+ * Table of in-flight deferred requests.
+ * Slots, the timer wheel and the counters belong to the receive loop;
+ * only the completion queue is shared with other threads.
+ */
+typedef struct {
+    PendingSlot *slots;
+    uint32_t capacity;
+    uint32_t free_head;
+    uint32_t in_flight;
+    TimerWheel wheel;
+
+    pthread_mutex_t lock;
+    PendingCompletion *completions;
+    int wake_fds[2];
+
+    uint64_t started;
+    uint64_t completed;
+    uint64_t timed_out;
+    uint64_t rejected;
+    uint64_t stale;
+} PendingTable;
+
+/**
+ * Callback used to emit the reply of a finished deferred request
+ *
+ * @param arg Argument passed to pending_drain/pending_expire
+ * @param client Original client address
+ * @param response Reply payload
+ * @param len Reply length
+ */
+typedef void (*PendingReplyFn)(void *arg, const struct sockaddr_in *client,
+                               const char *response, size_t len);
+
+/**
+ * Allocate the slot table and wake-up pipe
+ *
+ * @param table Table to initialize
+ * @param capacity Maximum number of in-flight requests
+ * @param now_ms Current monotonic time in milliseconds
+ * @return 0 on success, -1 on error
+ */
+int pending_table_init(PendingTable *table, uint32_t capacity, uint64_t now_ms);
+
+/**
+ * Release the table and any undelivered completions
+ *
+ * @param table Pending table
+ */
+void pending_table_free(PendingTable *table);
+
+/**
+ * Start tracking a deferred request (receive loop only)
+ *
+ * @param table Pending table
+ * @param client Client to reply to
+ * @param continuation Reply builder, or NULL to send the completion data as is
+ * @param user_data Argument for the continuation
+ * @param timeout_ms Time until the fallback reply is sent
+ * @param token Pointer to store the request token
+ * @return 0 on success, -1 if the table is full
+ */
+int pending_begin(PendingTable *table, const struct sockaddr_in *client,
+                  PendingContinuation continuation, void *user_data,
+                  uint32_t timeout_ms, PendingToken *token);
+
+/**
+ * Complete a deferred request. Safe to call from any thread.
+ * Completions for requests that already timed out are discarded.
+ *
+ * @param table Pending table
+ * @param token Token returned by pending_begin
+ * @param result Completion data (copied)
+ * @param len Length of the completion data
+ * @return 0 on success, -1 on allocation failure
+ */
+int pending_complete(PendingTable *table, PendingToken token, const void *result, size_t len);
+
+/**
+ * Get the descriptor that becomes readable when completions are queued
+ *
+ * @param table Pending table
+ * @return File descriptor to poll for POLLIN
+ */
+int pending_wake_fd(const PendingTable *table);
+
+/**
+ * Deliver queued completions (receive loop only)
+ *
+ * @param table Pending table
+ * @param scratch Buffer for continuation replies
+ * @param scratch_size Size of the scratch buffer
+ * @param reply Function that sends each reply
+ * @param arg Argument for the reply function
+ * @return Number of requests completed
+ */
+size_t pending_drain(PendingTable *table, char *scratch, size_t scratch_size,
+                     PendingReplyFn reply, void *arg);
+
+/**
+ * Expire overdue requests and send their fallback replies (receive loop only)
+ *
+ * @param table Pending table
+ * @param now_ms Current monotonic time in milliseconds
+ * @param fallback Reply used when the continuation provides none
+ * @param scratch Buffer for continuation replies
+ * @param scratch_size Size of the scratch buffer
+ * @param reply Function that sends each reply
+ * @param arg Argument for the reply function
+ * @return Number of requests expired
+ */
+size_t pending_expire(PendingTable *table, uint64_t now_ms, const char *fallback,
+                      char *scratch, size_t scratch_size, PendingReplyFn reply, void *arg);
+
+#endif /* PENDING_H */
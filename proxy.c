@@ -0,0 +1,578 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/resource.h>
+#include <arpa/inet.h>
+#include "proxy.h"
+#include "addr_utils.h"
+
+#ifdef __linux__
+#include <sys/epoll.h>
+
+#define PROXY_MAX_EVENTS 64
+// Upper bound of recvmmsg calls per ready socket and wakeup, for fairness
+#define PROXY_MAX_DRAIN 8
+// epoll timeout; bounds the latency of idle expiry and health checks
+#define PROXY_TICK_MS 10
+#define PROXY_TAG_LISTENER UINT64_MAX
+#define PROXY_TAG_PROBE (UINT64_MAX - 1)
+// Descriptors kept free for the listener, probe, epoll, log and metrics files
+#define PROXY_FD_HEADROOM 64
+
+static uint64_t fnv1a(const char *data, size_t len) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// Parse "a.b.c.d:port"
+static int parse_backend(const char *spec, ProxyBackend *backend) {
+    memset(backend, 0, sizeof(*backend));
+    if (parse_ipv4_endpoint(spec, &backend->addr) < 0) {
+        return -1;
+    }
+    strncpy(backend->name, spec, sizeof(backend->name) - 1);
+    backend->healthy = 1;
+    return 0;
+}
+
+static int compare_ring_points(const void *a, const void *b) {
+    const ProxyRingPoint *pa = a;
+    const ProxyRingPoint *pb = b;
+    return pa->hash < pb->hash ? -1 : pa->hash > pb->hash ? 1 : 0;
+}
+
+// Ring points derive from backend names, so every proxy instance builds the same ring
+static int build_ring(Proxy *proxy) {
+    proxy->ring_size = proxy->backend_count * PROXY_RING_REPLICAS;
+    proxy->ring = calloc(proxy->ring_size, sizeof(ProxyRingPoint));
+    if (!proxy->ring) {
+        return -1;
+    }
+
+    int n = 0;
+    for (int b = 0; b < proxy->backend_count; b++) {
+        for (int r = 0; r < PROXY_RING_REPLICAS; r++) {
+            char point[MAX_RULE_LENGTH + 16];
+            int len = snprintf(point, sizeof(point), "%s#%d", proxy->backends[b].name, r);
+            proxy->ring[n].hash = hash_mix64(fnv1a(point, len));
+            proxy->ring[n].backend = b;
+            n++;
+        }
+    }
+    qsort(proxy->ring, proxy->ring_size, sizeof(ProxyRingPoint), compare_ring_points);
+    return 0;
+}
+
+// Pick a healthy backend for a new flow, or -1 if none is healthy
+static int choose_backend(Proxy *proxy, const struct sockaddr_in *client) {
+    if (proxy->balance == PROXY_BALANCE_LEAST_OUTSTANDING) {
+        int best = -1;
+        for (int b = 0; b < proxy->backend_count; b++) {
+            if (proxy->backends[b].healthy &&
+                (best < 0 || proxy->backends[b].outstanding < proxy->backends[best].outstanding)) {
+                best = b;
+            }
+        }
+        return best;
+    }
+
+    // First ring point at or after the client hash, skipping unhealthy backends
+    uint64_t hash = ipv4_endpoint_hash(client);
+    int low = 0;
+    int high = proxy->ring_size;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (proxy->ring[mid].hash < hash) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    for (int i = 0; i < proxy->ring_size; i++) {
+        int backend = proxy->ring[(low + i) % proxy->ring_size].backend;
+        if (proxy->backends[backend].healthy) {
+            return backend;
+        }
+    }
+    return -1;
+}
+
+static int epoll_add_tagged(int epoll_fd, int fd, uint64_t tag) {
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.u64 = tag;
+    return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+}
+
+static void flow_close(Proxy *proxy, uint32_t index) {
+    ProxyFlow *flow = &proxy->flows[index];
+    ProxyBackend *backend = &proxy->backends[flow->backend];
+    backend->outstanding -= flow->outstanding < backend->outstanding ? flow->outstanding : backend->outstanding;
+
+    timer_wheel_remove(&proxy->idle_timers, &flow->timer);
+    flow_table_close(&proxy->flow_table, index);
+}
+
+static uint32_t flow_create(Proxy *proxy, const struct sockaddr_in *client, int backend, uint64_t now_ms) {
+    uint32_t index = flow_table_open(&proxy->flow_table, client, &proxy->backends[backend].addr);
+    if (index == FLOW_NONE) {
+        return FLOW_NONE;
+    }
+    if (epoll_add_tagged(proxy->epoll_fd, proxy->flow_table.entries[index].fd, index) < 0) {
+        flow_table_close(&proxy->flow_table, index);
+        return FLOW_NONE;
+    }
+
+    ProxyFlow *flow = &proxy->flows[index];
+    flow->backend = backend;
+    flow->outstanding = 0;
+    flow->last_active_ms = now_ms;
+
+    timer_wheel_add(&proxy->idle_timers, &flow->timer, now_ms + proxy->config->proxy_idle_timeout_ms);
+    proxy->metrics.proxy_flows_created++;
+    return index;
+}
+
+// Find the flow of a client, creating or re-pinning it as needed
+static uint32_t flow_for_client(Proxy *proxy, const struct sockaddr_in *client, uint64_t now_ms) {
+    uint32_t index = flow_table_lookup(&proxy->flow_table, client);
+
+    if (index != FLOW_NONE && !proxy->backends[proxy->flows[index].backend].healthy) {
+        int backend = choose_backend(proxy, client);
+        if (backend < 0) {
+            return index;
+        }
+        flow_close(proxy, index);
+        index = flow_create(proxy, client, backend, now_ms);
+        if (index == FLOW_NONE) {
+            proxy->metrics.proxy_flow_failures++;
+        }
+        return index;
+    }
+
+    if (index == FLOW_NONE) {
+        int backend = choose_backend(proxy, client);
+        if (backend < 0) {
+            proxy->metrics.proxy_no_backend++;
+            return FLOW_NONE;
+        }
+        index = flow_create(proxy, client, backend, now_ms);
+        if (index == FLOW_NONE) {
+            proxy->metrics.proxy_flow_failures++;
+        }
+    }
+    return index;
+}
+
+// Forward one client batch; datagrams of the same flow go out in one sendmmsg
+static void forward_client_batch(Proxy *proxy, int count, uint64_t now_ms) {
+    RecvBatch *batch = &proxy->client_batch;
+
+    for (int i = 0; i < count; i++) {
+        proxy->metrics.packets_received++;
+        proxy->metrics.bytes_received += batch->msgs[i].msg_len;
+        proxy->batch_flows[i] = flow_for_client(proxy, &batch->addrs[i], now_ms);
+        if (proxy->batch_flows[i] != FLOW_NONE) {
+            proxy->flows[proxy->batch_flows[i]].last_active_ms = now_ms;
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        uint32_t index = proxy->batch_flows[i];
+        if (index == FLOW_NONE) {
+            continue;
+        }
+
+        unsigned int grouped = 0;
+        for (int j = i; j < count; j++) {
+            if (proxy->batch_flows[j] != index) {
+                continue;
+            }
+            proxy->forward_iovecs[grouped].iov_base = recv_batch_payload(batch, j);
+            proxy->forward_iovecs[grouped].iov_len = batch->msgs[j].msg_len;
+            memset(&proxy->forward_msgs[grouped].msg_hdr, 0, sizeof(struct msghdr));
+            proxy->forward_msgs[grouped].msg_hdr.msg_iov = &proxy->forward_iovecs[grouped];
+            proxy->forward_msgs[grouped].msg_hdr.msg_iovlen = 1;
+            proxy->batch_flows[j] = FLOW_NONE;
+            grouped++;
+        }
+
+        ProxyFlow *flow = &proxy->flows[index];
+        ProxyBackend *backend = &proxy->backends[flow->backend];
+        int sent = send_batch(proxy->flow_table.entries[index].fd, proxy->forward_msgs, grouped);
+        flow->outstanding += sent;
+        backend->outstanding += sent;
+        backend->forwarded += sent;
+        proxy->metrics.proxy_forwarded += sent;
+        proxy->metrics.send_errors += grouped - sent;
+    }
+}
+
+// Send the queued client replies, counting bytes only for the ones sendmmsg accepted
+static void flush_client_replies(Proxy *proxy) {
+    SendBatch *replies = &proxy->client_replies;
+    unsigned int count = replies->count;
+    if (count == 0) {
+        return;
+    }
+    for (unsigned int i = 0; i < count; i++) {
+        replies->msgs[i].msg_len = 0;
+    }
+    int sent = send_batch_flush(proxy->listen_fd, replies);
+    proxy->metrics.packets_sent += sent;
+    proxy->metrics.send_errors += count - sent;
+    for (unsigned int i = 0; i < count; i++) {
+        proxy->metrics.bytes_sent += replies->msgs[i].msg_len;
+    }
+}
+
+static void queue_client_reply(Proxy *proxy, const struct sockaddr_in *client, const char *data, size_t len) {
+    if (proxy->client_replies.count >= proxy->client_replies.size) {
+        flush_client_replies(proxy);
+    }
+    send_batch_add(&proxy->client_replies, client, data, len);
+}
+
+// Relay everything a backend sent on a flow socket back to the flow's client
+static void relay_upstream(Proxy *proxy, uint32_t index, uint64_t now_ms) {
+    const FlowEntry *entry = &proxy->flow_table.entries[index];
+    ProxyFlow *flow = &proxy->flows[index];
+    ProxyBackend *backend = &proxy->backends[flow->backend];
+
+    for (int round = 0; round < PROXY_MAX_DRAIN; round++) {
+        int count = recv_batch(entry->fd, &proxy->upstream_batch);
+        if (count < 0) {
+            // e.g. ECONNREFUSED after an ICMP port unreachable; health checks decide
+            proxy->metrics.receive_errors++;
+            break;
+        }
+        if (count == 0) {
+            break;
+        }
+
+        for (int i = 0; i < count; i++) {
+            queue_client_reply(proxy, &entry->client, recv_batch_payload(&proxy->upstream_batch, i),
+                               proxy->upstream_batch.msgs[i].msg_len);
+        }
+        uint32_t answered = (uint32_t)count < flow->outstanding ? (uint32_t)count : flow->outstanding;
+        flow->outstanding -= answered;
+        backend->outstanding -= answered < backend->outstanding ? answered : backend->outstanding;
+        backend->relayed += count;
+        proxy->metrics.proxy_relayed += count;
+        flow->last_active_ms = now_ms;
+
+        if ((unsigned int)count < proxy->upstream_batch.size) {
+            break;
+        }
+    }
+}
+
+typedef struct {
+    Proxy *proxy;
+    uint64_t now_ms;
+} IdleContext;
+
+// Idle timers are not re-armed on every datagram; re-check activity when one fires
+static void expire_idle_flow(TimerNode *node, void *arg) {
+    IdleContext *ctx = arg;
+    ProxyFlow *flow = (ProxyFlow *)node;
+    uint64_t idle_ms = ctx->proxy->config->proxy_idle_timeout_ms;
+
+    if (ctx->now_ms - flow->last_active_ms < idle_ms) {
+        timer_wheel_add(&ctx->proxy->idle_timers, &flow->timer, flow->last_active_ms + idle_ms);
+        return;
+    }
+    flow_close(ctx->proxy, (uint32_t)(flow - ctx->proxy->flows));
+    ctx->proxy->metrics.proxy_flows_expired++;
+}
+
+static void log_backend_state(Proxy *proxy, const ProxyBackend *backend) {
+    char message[MAX_RULE_LENGTH + 32];
+    snprintf(message, sizeof(message), "Backend %s is %s", backend->name,
+             backend->healthy ? "healthy" : "unhealthy");
+    printf("%s\n", message);
+    if (proxy->log_fp) {
+        write_json_log(proxy->log_fp, backend->healthy ? "backend_up" : "backend_down", message, NULL, 0);
+    }
+}
+
+static void receive_probe_replies(Proxy *proxy) {
+    int count;
+    while ((count = recv_batch(proxy->probe_fd, &proxy->upstream_batch)) > 0) {
+        for (int i = 0; i < count; i++) {
+            for (int b = 0; b < proxy->backend_count; b++) {
+                ProxyBackend *backend = &proxy->backends[b];
+                if (!same_ipv4_endpoint(&backend->addr, &proxy->upstream_batch.addrs[i])) {
+                    continue;
+                }
+                backend->probe_answered = 1;
+                backend->failures = 0;
+                if (!backend->healthy) {
+                    backend->healthy = 1;
+                    log_backend_state(proxy, backend);
+                }
+            }
+        }
+    }
+}
+
+// Send one probe per backend in a single sendmmsg and judge the previous round
+static void run_health_checks(Proxy *proxy, uint64_t now_ms) {
+    const ServerConfig *config = proxy->config;
+    if (config->proxy_health_interval_ms <= 0) {
+        return;
+    }
+
+    if (proxy->probe_deadline_ms != 0 && now_ms >= proxy->probe_deadline_ms) {
+        for (int b = 0; b < proxy->backend_count; b++) {
+            ProxyBackend *backend = &proxy->backends[b];
+            if (backend->probe_answered) {
+                continue;
+            }
+            backend->failures++;
+            if (backend->healthy && backend->failures >= config->proxy_health_fail_threshold) {
+                backend->healthy = 0;
+                log_backend_state(proxy, backend);
+            }
+        }
+        proxy->probe_deadline_ms = 0;
+    }
+
+    if (now_ms < proxy->next_probe_ms) {
+        return;
+    }
+
+    struct mmsghdr probes[MAX_PROXY_BACKENDS];
+    struct iovec probe_iovec;
+    probe_iovec.iov_base = (void *)config->proxy_health_payload;
+    probe_iovec.iov_len = strlen(config->proxy_health_payload);
+
+    for (int b = 0; b < proxy->backend_count; b++) {
+        memset(&probes[b], 0, sizeof(probes[b]));
+        probes[b].msg_hdr.msg_name = &proxy->backends[b].addr;
+        probes[b].msg_hdr.msg_namelen = sizeof(proxy->backends[b].addr);
+        probes[b].msg_hdr.msg_iov = &probe_iovec;
+        probes[b].msg_hdr.msg_iovlen = 1;
+        proxy->backends[b].probe_answered = 0;
+    }
+    send_batch(proxy->probe_fd, probes, proxy->backend_count);
+
+    proxy->probe_deadline_ms = now_ms + config->proxy_health_timeout_ms;
+    proxy->next_probe_ms = now_ms + config->proxy_health_interval_ms;
+}
+
+static void write_proxy_metrics(Proxy *proxy) {
+    ServerMetrics *metrics = &proxy->metrics;
+    metrics->proxy_enabled = 1;
+    metrics->proxy_flows_active = proxy->flow_table.active;
+    metrics->proxy_backend_count = proxy->backend_count;
+    for (int b = 0; b < proxy->backend_count; b++) {
+        BackendMetrics *out = &metrics->proxy_backends[b];
+        strncpy(out->name, proxy->backends[b].name, sizeof(out->name) - 1);
+        out->healthy = proxy->backends[b].healthy;
+        out->outstanding = proxy->backends[b].outstanding;
+        out->forwarded = proxy->backends[b].forwarded;
+        out->relayed = proxy->backends[b].relayed;
+    }
+
+    if (write_metrics(metrics, proxy->config->metrics_file) < 0 && proxy->log_fp) {
+        write_json_log(proxy->log_fp, "error", "Failed to write metrics", NULL, 0);
+    }
+}
+
+// Every flow owns a socket: raise the descriptor limit as far as allowed and
+// shrink the flow table to what still fits
+static uint32_t fit_flows_to_fd_limit(Proxy *proxy, uint32_t max_flows) {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) < 0) {
+        return max_flows;
+    }
+
+    rlim_t wanted = (rlim_t)max_flows + PROXY_FD_HEADROOM;
+    if (limit.rlim_cur != RLIM_INFINITY && limit.rlim_cur < wanted) {
+        struct rlimit raised = limit;
+        raised.rlim_cur = limit.rlim_max == RLIM_INFINITY || limit.rlim_max > wanted ? wanted : limit.rlim_max;
+        if (setrlimit(RLIMIT_NOFILE, &raised) == 0) {
+            limit = raised;
+        }
+    }
+
+    if (limit.rlim_cur != RLIM_INFINITY && limit.rlim_cur < wanted) {
+        uint32_t fitted = limit.rlim_cur > PROXY_FD_HEADROOM ? (uint32_t)(limit.rlim_cur - PROXY_FD_HEADROOM) : 1;
+        char message[128];
+        snprintf(message, sizeof(message), "Descriptor limit %llu allows %u of %u proxy flows",
+                 (unsigned long long)limit.rlim_cur, fitted, max_flows);
+        fprintf(stderr, "%s\n", message);
+        if (proxy->log_fp) {
+            write_json_log(proxy->log_fp, "warning", message, NULL, 0);
+        }
+        return fitted;
+    }
+    return max_flows;
+}
+
+int proxy_init(Proxy *proxy, const ServerConfig *config, int listen_fd, FILE *log_fp) {
+    memset(proxy, 0, sizeof(*proxy));
+    proxy->config = config;
+    proxy->log_fp = log_fp;
+    proxy->listen_fd = listen_fd;
+    proxy->probe_fd = -1;
+    proxy->epoll_fd = -1;
+
+    for (int i = 0; i < config->proxy_backend_count; i++) {
+        if (parse_backend(config->proxy_backends[i], &proxy->backends[proxy->backend_count]) < 0) {
+            fprintf(stderr, "Ignoring invalid backend: %s\n", config->proxy_backends[i]);
+            continue;
+        }
+        proxy->backend_count++;
+    }
+    if (proxy->backend_count == 0) {
+        fprintf(stderr, "Proxy mode needs at least one backend (proxy.backends)\n");
+        return -1;
+    }
+
+    proxy->balance = strcmp(config->proxy_balance, "least_outstanding") == 0
+                         ? PROXY_BALANCE_LEAST_OUTSTANDING
+                         : PROXY_BALANCE_CONSISTENT_HASH;
+    if (proxy->balance == PROXY_BALANCE_CONSISTENT_HASH && build_ring(proxy) < 0) {
+        return -1;
+    }
+
+    uint32_t max_flows = fit_flows_to_fd_limit(proxy, (uint32_t)config->proxy_max_flows);
+    if (flow_table_init(&proxy->flow_table, max_flows) < 0) {
+        perror("Memory allocation failed");
+        return -1;
+    }
+    proxy->flows = calloc(max_flows, sizeof(ProxyFlow));
+    proxy->forward_msgs = calloc(config->batch_size, sizeof(struct mmsghdr));
+    proxy->forward_iovecs = calloc(config->batch_size, sizeof(struct iovec));
+    proxy->batch_flows = calloc(config->batch_size, sizeof(uint32_t));
+    if (!proxy->flows || !proxy->forward_msgs || !proxy->forward_iovecs ||
+        !proxy->batch_flows ||
+        recv_batch_init(&proxy->client_batch, config->batch_size, config->buffer_size) < 0 ||
+        recv_batch_init(&proxy->upstream_batch, config->batch_size, config->buffer_size) < 0 ||
+        send_batch_init(&proxy->client_replies, config->batch_size, config->buffer_size) < 0) {
+        perror("Memory allocation failed");
+        return -1;
+    }
+    timer_wheel_init(&proxy->idle_timers, monotonic_ms());
+
+    proxy->probe_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    proxy->epoll_fd = epoll_create1(0);
+    if (proxy->probe_fd < 0 || proxy->epoll_fd < 0) {
+        perror("Proxy socket setup failed");
+        return -1;
+    }
+    fcntl(proxy->probe_fd, F_SETFL, fcntl(proxy->probe_fd, F_GETFL) | O_NONBLOCK);
+    if (epoll_add_tagged(proxy->epoll_fd, listen_fd, PROXY_TAG_LISTENER) < 0 ||
+        epoll_add_tagged(proxy->epoll_fd, proxy->probe_fd, PROXY_TAG_PROBE) < 0) {
+        perror("epoll_ctl failed");
+        return -1;
+    }
+
+    printf("Proxy mode: %d backends, balance=%s, max flows=%u\n", proxy->backend_count,
+           proxy->balance == PROXY_BALANCE_LEAST_OUTSTANDING ? "least_outstanding" : "consistent_hash",
+           proxy->flow_table.capacity);
+    return 0;
+}
+
+int proxy_run(Proxy *proxy) {
+    const ServerConfig *config = proxy->config;
+    struct epoll_event events[PROXY_MAX_EVENTS];
+    uint64_t next_metrics_ms = monotonic_ms();
+
+    while (1) {
+        int ready = epoll_wait(proxy->epoll_fd, events, PROXY_MAX_EVENTS, PROXY_TICK_MS);
+        uint64_t now_ms = monotonic_ms();
+
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("epoll_wait failed");
+            return -1;
+        }
+
+        for (int e = 0; e < ready; e++) {
+            uint64_t tag = events[e].data.u64;
+            if (tag == PROXY_TAG_LISTENER) {
+                for (int round = 0; round < PROXY_MAX_DRAIN; round++) {
+                    int count = recv_batch(proxy->listen_fd, &proxy->client_batch);
+                    if (count < 0) {
+                        proxy->metrics.receive_errors++;
+                        break;
+                    }
+                    if (count == 0) {
+                        break;
+                    }
+                    proxy->metrics.batches++;
+                    forward_client_batch(proxy, count, now_ms);
+                }
+            } else if (tag == PROXY_TAG_PROBE) {
+                receive_probe_replies(proxy);
+            } else if (tag < proxy->flow_table.capacity && proxy->flow_table.entries[tag].in_use) {
+                relay_upstream(proxy, (uint32_t)tag, now_ms);
+            }
+        }
+
+        flush_client_replies(proxy);
+
+        IdleContext idle = { proxy, now_ms };
+        timer_wheel_advance(&proxy->idle_timers, now_ms, expire_idle_flow, &idle);
+        run_health_checks(proxy, now_ms);
+
+        if (config->metrics_interval > 0 && now_ms >= next_metrics_ms) {
+            write_proxy_metrics(proxy);
+            next_metrics_ms = now_ms + (uint64_t)config->metrics_interval * 1000;
+        }
+    }
+}
+
+void proxy_free(Proxy *proxy) {
+    flow_table_free(&proxy->flow_table);
+    if (proxy->probe_fd >= 0) {
+        close(proxy->probe_fd);
+    }
+    if (proxy->epoll_fd >= 0) {
+        close(proxy->epoll_fd);
+    }
+    recv_batch_free(&proxy->client_batch);
+    recv_batch_free(&proxy->upstream_batch);
+    send_batch_free(&proxy->client_replies);
+    free(proxy->flows);
+    free(proxy->ring);
+    free(proxy->forward_msgs);
+    free(proxy->forward_iovecs);
+    free(proxy->batch_flows);
+    memset(proxy, 0, sizeof(*proxy));
+}
+
+#else
+
+int proxy_init(Proxy *proxy, const ServerConfig *config, int listen_fd, FILE *log_fp) {
+    (void)config;
+    (void)listen_fd;
+    (void)log_fp;
+    memset(proxy, 0, sizeof(*proxy));
+    fprintf(stderr, "Proxy mode requires Linux (epoll)\n");
+    return -1;
+}
+
+int proxy_run(Proxy *proxy) {
+    (void)proxy;
+    return -1;
+}
+
+void proxy_free(Proxy *proxy) {
+    (void)proxy;
+}
+
+#endif
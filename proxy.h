@@ -0,0 +1,116 @@
+#ifndef PROXY_H
+#define PROXY_H
+
+#include <stdint.h>
+#include <netinet/in.h>
+#include "udp_server.h"
+#include "batch_io.h"
+#include "timer_wheel.h"
+#include "flow_table.h"
+#include "metrics.h"
+
+// Virtual nodes per backend on the consistent hash ring
+#define PROXY_RING_REPLICAS 160
+
+/**
+ * Backend selection policy for new flows
+ */
+typedef enum {
+    PROXY_BALANCE_CONSISTENT_HASH = 0,
+    PROXY_BALANCE_LEAST_OUTSTANDING
+} ProxyBalance;
+
+/**
+ * Upstream UDP server and its health state
+ */
+typedef struct {
+    struct sockaddr_in addr;
+    char name[MAX_RULE_LENGTH];
+    int healthy;
+    int failures;
+    int probe_answered;
+    uint64_t outstanding;
+    uint64_t forwarded;
+    uint64_t relayed;
+} ProxyBackend;
+
+/**
+ * Proxy state of one client flow, indexed like the flow table entries.
+ * The timer node comes first so an expired TimerNode can be cast back to
+ * its flow.
+ */
+typedef struct {
+    TimerNode timer;
+    int backend;
+    uint32_t outstanding;
+    uint64_t last_active_ms;
+} ProxyFlow;
+
+/**
+ * Point on the consistent hash ring
+ */
+typedef struct {
+    uint64_t hash;
+    int backend;
+} ProxyRingPoint;
+
+/**
+ * Proxy state: backends, flow table and both batch directions
+ */
+typedef struct {
+    const ServerConfig *config;
+    FILE *log_fp;
+    int listen_fd;
+    int probe_fd;
+    int epoll_fd;
+
+    ProxyBackend backends[MAX_PROXY_BACKENDS];
+    int backend_count;
+    ProxyBalance balance;
+    ProxyRingPoint *ring;
+    int ring_size;
+
+    FlowTable flow_table;
+    ProxyFlow *flows;
+    TimerWheel idle_timers;
+
+    RecvBatch client_batch;
+    RecvBatch upstream_batch;
+    SendBatch client_replies;
+    struct mmsghdr *forward_msgs;
+    struct iovec *forward_iovecs;
+    uint32_t *batch_flows;
+
+    uint64_t next_probe_ms;
+    uint64_t probe_deadline_ms;
+
+    ServerMetrics metrics;
+} Proxy;
+
+/**
+ * Parse the backend list and allocate the flow table
+ *
+ * @param proxy Proxy to initialize
+ * @param config Server configuration
+ * @param listen_fd Bound client-facing socket
+ * @param log_fp Log file pointer (can be NULL)
+ * @return 0 on success, -1 on error
+ */
+int proxy_init(Proxy *proxy, const ServerConfig *config, int listen_fd, FILE *log_fp);
+
+/**
+ * Relay datagrams between clients and backends until an error occurs
+ *
+ * @param proxy Initialized proxy
+ * @return -1 on fatal error
+ */
+int proxy_run(Proxy *proxy);
+
+/**
+ * Close all flow sockets and release the proxy
+ *
+ * @param proxy Proxy to free
+ */
+void proxy_free(Proxy *proxy);
+
+#endif /* PROXY_H */
@@ -0,0 +1,438 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "handler.h"
+#include "batch_io.h"
+
+// Publish/subscribe handler. Text protocol:
+//   SUBSCRIBE <topic>          -> SUBSCRIBED <topic> <lease seconds>
+//   UNSUBSCRIBE <topic>        -> UNSUBSCRIBED <topic>
+//   PUBLISH <topic> <payload>  -> PUBLISHED <topic> <deliveries>
+// Subscribers receive "<topic> <payload>". Every fan-out datagram points
+// into the receive buffer of the PUBLISH request, so the payload is never
+// copied per subscriber.
+
+#define PUBSUB_MAX_TOPIC 64
+#define PUBSUB_EMPTY 0
+// Sweep expired leases at most once per second
+#define PUBSUB_SWEEP_MS 1000
+
+/**
+ * Compact subscriber entry (addresses in network byte order)
+ */
+typedef struct {
+    uint32_t ip;
+    uint16_t port;
+    uint32_t expires;
+} Subscriber;
+
+typedef struct {
+    char name[PUBSUB_MAX_TOPIC + 1];
+    uint64_t hash;
+    int in_use;
+    Subscriber *subs;
+    uint32_t count;
+    uint32_t capacity;
+} Topic;
+
+/**
+ * Subscription index entry: (topic, ip, port) -> position in Topic.subs.
+ * topic holds the topic slot + 1 so that 0 marks an empty entry.
+ */
+typedef struct {
+    uint32_t topic;
+    uint32_t ip;
+    uint16_t port;
+    uint32_t position;
+} SubscriptionEntry;
+
+typedef struct {
+    Topic *topics;
+    uint32_t topic_mask;
+    uint32_t topic_count;
+    uint32_t max_topics;
+
+    SubscriptionEntry *index;
+    uint32_t index_mask;
+    uint32_t subscriptions;
+    uint32_t max_subscriptions;
+
+    uint32_t lease_seconds;
+    unsigned int fanout_batch;
+    struct mmsghdr *msgs;
+    struct sockaddr_in *addrs;
+    uint64_t last_sweep_ms;
+
+    uint64_t publishes;
+    uint64_t deliveries;
+    uint64_t fanout_drops;
+    uint64_t expired;
+    double fanout_cpu_seconds;
+} PubSubState;
+
+static uint64_t hash_bytes(const char *data, size_t len) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash ^ (hash >> 29);
+}
+
+static uint64_t subscription_hash(uint32_t topic, uint32_t ip, uint16_t port) {
+    uint64_t x = ((uint64_t)topic << 48) ^ ((uint64_t)ip << 16) ^ port;
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return x;
+}
+
+// Leases are measured on the monotonic clock in whole seconds
+static uint32_t now_seconds(void) {
+    return (uint32_t)(monotonic_ms() / 1000);
+}
+
+static double thread_cpu_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint32_t round_up_pow2(uint32_t value) {
+    uint32_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+// Find a topic slot, optionally claiming an empty one; returns -1 if absent or full
+static int find_topic(PubSubState *state, const char *name, size_t len, int create) {
+    uint64_t hash = hash_bytes(name, len);
+    uint32_t slot = (uint32_t)hash & state->topic_mask;
+
+    while (state->topics[slot].in_use) {
+        Topic *topic = &state->topics[slot];
+        if (topic->hash == hash && strlen(topic->name) == len && memcmp(topic->name, name, len) == 0) {
+            return (int)slot;
+        }
+        slot = (slot + 1) & state->topic_mask;
+    }
+
+    // Topics are never removed, so probing stops at the first free slot
+    if (!create || state->topic_count >= state->max_topics) {
+        return -1;
+    }
+    Topic *topic = &state->topics[slot];
+    memcpy(topic->name, name, len);
+    topic->name[len] = '\0';
+    topic->hash = hash;
+    topic->in_use = 1;
+    state->topic_count++;
+    return (int)slot;
+}
+
+static SubscriptionEntry *find_subscription(PubSubState *state, uint32_t topic, uint32_t ip, uint16_t port) {
+    uint32_t slot = (uint32_t)subscription_hash(topic, ip, port) & state->index_mask;
+    while (state->index[slot].topic != PUBSUB_EMPTY) {
+        SubscriptionEntry *entry = &state->index[slot];
+        if (entry->topic == topic + 1 && entry->ip == ip && entry->port == port) {
+            return entry;
+        }
+        slot = (slot + 1) & state->index_mask;
+    }
+    return NULL;
+}
+
+static SubscriptionEntry *insert_subscription(PubSubState *state, uint32_t topic, uint32_t ip, uint16_t port) {
+    uint32_t slot = (uint32_t)subscription_hash(topic, ip, port) & state->index_mask;
+    while (state->index[slot].topic != PUBSUB_EMPTY) {
+        slot = (slot + 1) & state->index_mask;
+    }
+    SubscriptionEntry *entry = &state->index[slot];
+    entry->topic = topic + 1;
+    entry->ip = ip;
+    entry->port = port;
+    return entry;
+}
+
+// Linear probing deletion by backward shift, so lookups never need tombstones
+static void delete_subscription(PubSubState *state, SubscriptionEntry *entry) {
+    uint32_t hole = (uint32_t)(entry - state->index);
+    uint32_t slot = hole;
+
+    while (1) {
+        slot = (slot + 1) & state->index_mask;
+        SubscriptionEntry *candidate = &state->index[slot];
+        if (candidate->topic == PUBSUB_EMPTY) {
+            break;
+        }
+        uint32_t home = (uint32_t)subscription_hash(candidate->topic - 1, candidate->ip, candidate->port) &
+                        state->index_mask;
+        // Move the candidate into the hole unless its home lies cyclically in (hole, slot]
+        if (((slot - home) & state->index_mask) >= ((slot - hole) & state->index_mask)) {
+            state->index[hole] = *candidate;
+            hole = slot;
+        }
+    }
+    state->index[hole].topic = PUBSUB_EMPTY;
+}
+
+// Swap-remove a subscriber and keep the index pointing at the moved entry
+static void remove_subscriber(PubSubState *state, uint32_t topic_slot, uint32_t position) {
+    Topic *topic = &state->topics[topic_slot];
+    Subscriber removed = topic->subs[position];
+    uint32_t last = topic->count - 1;
+
+    if (position != last) {
+        Subscriber moved = topic->subs[last];
+        topic->subs[position] = moved;
+        find_subscription(state, topic_slot, moved.ip, moved.port)->position = position;
+    }
+    topic->count--;
+
+    delete_subscription(state, find_subscription(state, topic_slot, removed.ip, removed.port));
+    state->subscriptions--;
+}
+
+static void handle_subscribe(PubSubState *state, HandlerCall *call, const char *name, size_t len) {
+    int slot = find_topic(state, name, len, 1);
+    if (slot < 0) {
+        handler_reply(call, "ERROR too many topics");
+        return;
+    }
+
+    Topic *topic = &state->topics[slot];
+    uint32_t ip = call->client->sin_addr.s_addr;
+    uint16_t port = call->client->sin_port;
+    uint32_t expires = now_seconds() + state->lease_seconds;
+
+    SubscriptionEntry *entry = find_subscription(state, slot, ip, port);
+    if (entry) {
+        // Renewal
+        topic->subs[entry->position].expires = expires;
+    } else {
+        if (state->subscriptions >= state->max_subscriptions) {
+            handler_reply(call, "ERROR too many subscriptions");
+            return;
+        }
+        if (topic->count == topic->capacity) {
+            uint32_t capacity = topic->capacity ? topic->capacity * 2 : 16;
+            Subscriber *subs = realloc(topic->subs, capacity * sizeof(Subscriber));
+            if (!subs) {
+                handler_reply(call, "ERROR out of memory");
+                return;
+            }
+            topic->subs = subs;
+            topic->capacity = capacity;
+        }
+        Subscriber *sub = &topic->subs[topic->count];
+        sub->ip = ip;
+        sub->port = port;
+        sub->expires = expires;
+        insert_subscription(state, slot, ip, port)->position = topic->count;
+        topic->count++;
+        state->subscriptions++;
+    }
+
+    int written = snprintf(call->response_buffer, call->response_buffer_size, "SUBSCRIBED %s %u",
+                           topic->name, state->lease_seconds);
+    call->response = call->response_buffer;
+    call->response_len = written > 0 ? (size_t)written : 0;
+}
+
+static void handle_unsubscribe(PubSubState *state, HandlerCall *call, const char *name, size_t len) {
+    int slot = find_topic(state, name, len, 0);
+    SubscriptionEntry *entry = slot < 0 ? NULL :
+        find_subscription(state, slot, call->client->sin_addr.s_addr, call->client->sin_port);
+    if (entry) {
+        remove_subscriber(state, slot, entry->position);
+    }
+
+    int written = snprintf(call->response_buffer, call->response_buffer_size, "UNSUBSCRIBED %.*s",
+                           (int)len, name);
+    call->response = call->response_buffer;
+    call->response_len = written > 0 ? (size_t)written : 0;
+}
+
+// Send one shared iovec to every live subscriber in sendmmsg batches. The server
+// socket is blocking, so MSG_DONTWAIT keeps a full send queue from stalling the
+// handler thread; whatever does not fit is counted as dropped.
+static uint64_t fan_out(PubSubState *state, int sockfd, Topic *topic, struct iovec *message) {
+    uint32_t now = now_seconds();
+    uint64_t delivered = 0;
+    unsigned int queued = 0;
+
+    for (uint32_t i = 0; i < topic->count; i++) {
+        const Subscriber *sub = &topic->subs[i];
+        if (sub->expires <= now) {
+            continue;
+        }
+
+        struct sockaddr_in *addr = &state->addrs[queued];
+        addr->sin_addr.s_addr = sub->ip;
+        addr->sin_port = sub->port;
+        state->msgs[queued].msg_hdr.msg_iov = message;
+        queued++;
+
+        if (queued == state->fanout_batch) {
+            int sent = send_batch_flags(sockfd, state->msgs, queued, MSG_DONTWAIT);
+            delivered += sent;
+            state->fanout_drops += queued - sent;
+            queued = 0;
+        }
+    }
+
+    if (queued > 0) {
+        int sent = send_batch_flags(sockfd, state->msgs, queued, MSG_DONTWAIT);
+        delivered += sent;
+        state->fanout_drops += queued - sent;
+    }
+    return delivered;
+}
+
+static void handle_publish(PubSubState *state, HandlerCall *call, const char *body, size_t body_len) {
+    // body is "<topic> <payload>", which is also exactly what subscribers receive
+    const char *space = memchr(body, ' ', body_len);
+    size_t name_len = space ? (size_t)(space - body) : body_len;
+    if (name_len == 0 || name_len > PUBSUB_MAX_TOPIC) {
+        handler_reply(call, "ERROR invalid topic");
+        return;
+    }
+
+    uint64_t delivered = 0;
+    int slot = find_topic(state, body, name_len, 0);
+    if (slot >= 0 && state->topics[slot].count > 0) {
+        struct iovec message = { (void *)body, body_len };
+        double cpu_start = thread_cpu_seconds();
+        delivered = fan_out(state, call->sockfd, &state->topics[slot], &message);
+        state->fanout_cpu_seconds += thread_cpu_seconds() - cpu_start;
+    }
+    state->publishes++;
+    state->deliveries += delivered;
+
+    int written = snprintf(call->response_buffer, call->response_buffer_size, "PUBLISHED %.*s %llu",
+                           (int)name_len, body, (unsigned long long)delivered);
+    call->response = call->response_buffer;
+    call->response_len = written > 0 ? (size_t)written : 0;
+}
+
+static HandlerResult pubsub_handle(void *arg, HandlerCall *call) {
+    PubSubState *state = arg;
+    const char *payload = call->payload;
+    size_t len = call->len;
+
+    // Tolerate a trailing newline from line-oriented tools
+    while (len > 0 && (payload[len - 1] == '\n' || payload[len - 1] == '\r')) {
+        len--;
+    }
+
+    if (len > 10 && memcmp(payload, "SUBSCRIBE ", 10) == 0 && len - 10 <= PUBSUB_MAX_TOPIC) {
+        handle_subscribe(state, call, payload + 10, len - 10);
+    } else if (len > 12 && memcmp(payload, "UNSUBSCRIBE ", 12) == 0 && len - 12 <= PUBSUB_MAX_TOPIC) {
+        handle_unsubscribe(state, call, payload + 12, len - 12);
+    } else if (len > 8 && memcmp(payload, "PUBLISH ", 8) == 0) {
+        handle_publish(state, call, payload + 8, len - 8);
+    } else {
+        handler_reply(call, "ERROR unknown command");
+    }
+    return HANDLER_DONE;
+}
+
+// Drop expired leases of topics that nobody publishes to
+static void pubsub_tick(void *arg, uint64_t now_ms) {
+    PubSubState *state = arg;
+    if (now_ms - state->last_sweep_ms < PUBSUB_SWEEP_MS) {
+        return;
+    }
+    state->last_sweep_ms = now_ms;
+
+    uint32_t now = now_seconds();
+    for (uint32_t slot = 0; slot <= state->topic_mask; slot++) {
+        Topic *topic = &state->topics[slot];
+        uint32_t i = 0;
+        while (i < topic->count) {
+            if (topic->subs[i].expires <= now) {
+                remove_subscriber(state, slot, i);
+                state->expired++;
+            } else {
+                i++;
+            }
+        }
+    }
+}
+
+static void pubsub_report(void *arg, ServerMetrics *metrics) {
+    PubSubState *state = arg;
+    metrics->pubsub_enabled = 1;
+    metrics->pubsub_topics = state->topic_count;
+    metrics->pubsub_subscriptions = state->subscriptions;
+    metrics->pubsub_expired = state->expired;
+    metrics->pubsub_publishes = state->publishes;
+    metrics->pubsub_deliveries = state->deliveries;
+    metrics->pubsub_fanout_drops = state->fanout_drops;
+    metrics->pubsub_fanout_cpu_seconds = state->fanout_cpu_seconds;
+    metrics->pubsub_deliveries_per_core_second =
+        state->fanout_cpu_seconds > 0.0 ? state->deliveries / state->fanout_cpu_seconds : 0.0;
+}
+
+static void pubsub_destroy(void *arg) {
+    PubSubState *state = arg;
+    if (state->topics) {
+        for (uint32_t slot = 0; slot <= state->topic_mask; slot++) {
+            free(state->topics[slot].subs);
+        }
+    }
+    free(state->topics);
+    free(state->index);
+    free(state->msgs);
+    free(state->addrs);
+    free(state);
+}
+
+static int pubsub_init(const ServerConfig *config, void **state_out) {
+    PubSubState *state = calloc(1, sizeof(PubSubState));
+    if (!state) {
+        return -1;
+    }
+
+    state->max_topics = config->pubsub_max_topics;
+    state->max_subscriptions = config->pubsub_max_subscriptions;
+    state->lease_seconds = config->pubsub_lease_seconds;
+    state->fanout_batch = config->pubsub_fanout_batch;
+    state->last_sweep_ms = monotonic_ms();
+
+    // Keep both open-addressing tables at most half full
+    uint32_t topic_slots = round_up_pow2(state->max_topics * 2);
+    uint32_t index_slots = round_up_pow2(state->max_subscriptions * 2);
+    state->topic_mask = topic_slots - 1;
+    state->index_mask = index_slots - 1;
+    state->topics = calloc(topic_slots, sizeof(Topic));
+    state->index = calloc(index_slots, sizeof(SubscriptionEntry));
+    state->msgs = calloc(state->fanout_batch, sizeof(struct mmsghdr));
+    state->addrs = calloc(state->fanout_batch, sizeof(struct sockaddr_in));
+    if (!state->topics || !state->index || !state->msgs || !state->addrs) {
+        pubsub_destroy(state);
+        return -1;
+    }
+
+    for (unsigned int i = 0; i < state->fanout_batch; i++) {
+        state->addrs[i].sin_family = AF_INET;
+        state->msgs[i].msg_hdr.msg_name = &state->addrs[i];
+        state->msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+        state->msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    *state_out = state;
+    return 0;
+}
+
+const RequestHandler pubsub_handler = {
+    .name = "pubsub",
+    .init = pubsub_init,
+    .handle = pubsub_handle,
+    .destroy = pubsub_destroy,
+    .tick = pubsub_tick,
+    .report = pubsub_report
+};
@@ -0,0 +1,210 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <pthread.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include "handler.h"
+#include "trace.h"
+
+// Hostname lookup handler: each datagram carries a hostname, the reply is its
+// first IPv4 address. getaddrinfo() blocks, so lookups run on worker threads
+// and complete the deferred request when done.
+
+#define RESOLVE_MAX_HOST 256
+
+typedef struct ResolveJob {
+    struct ResolveJob *next;
+    PendingTable *pending;
+    PendingToken token;
+    uint64_t expires_ms;
+    char host[RESOLVE_MAX_HOST];
+} ResolveJob;
+
+typedef struct {
+    pthread_t *threads;
+    int thread_count;
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    ResolveJob *head;
+    ResolveJob *tail;
+    int queued;
+    int max_queued;
+    int stopping;
+    const char *busy_message;
+} ResolveState;
+
+static void *resolve_worker(void *arg) {
+    ResolveState *state = arg;
+    trace_thread_start("resolve worker");
+
+    while (1) {
+        pthread_mutex_lock(&state->lock);
+        while (!state->head && !state->stopping) {
+            pthread_cond_wait(&state->ready, &state->lock);
+        }
+        if (state->stopping) {
+            pthread_mutex_unlock(&state->lock);
+            break;
+        }
+        ResolveJob *job = state->head;
+        state->head = job->next;
+        if (!state->head) {
+            state->tail = NULL;
+        }
+        state->queued--;
+        pthread_mutex_unlock(&state->lock);
+
+        // The request already got its fallback reply; a late answer would be discarded
+        if (monotonic_ms() >= job->expires_ms) {
+            free(job);
+            continue;
+        }
+
+        TRACE_SAMPLE();
+        TRACE_BEGIN(lookup_start);
+        char result[RESOLVE_MAX_HOST + INET_ADDRSTRLEN + 16];
+        struct addrinfo hints, *info = NULL;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_DGRAM;
+
+        if (getaddrinfo(job->host, NULL, &hints, &info) == 0 && info) {
+            char ip[INET_ADDRSTRLEN];
+            const struct sockaddr_in *addr = (const struct sockaddr_in *)info->ai_addr;
+            inet_ntop(AF_INET, &addr->sin_addr, ip, sizeof(ip));
+            snprintf(result, sizeof(result), "%s %s", job->host, ip);
+        } else {
+            snprintf(result, sizeof(result), "%s not found", job->host);
+        }
+        if (info) {
+            freeaddrinfo(info);
+        }
+        TRACE_END(TRACE_RESOLVE, lookup_start);
+
+        pending_complete(job->pending, job->token, result, strlen(result));
+        free(job);
+    }
+    return NULL;
+}
+
+static int resolve_init(const ServerConfig *config, void **state_out) {
+    ResolveState *state = calloc(1, sizeof(ResolveState));
+    if (!state) {
+        return -1;
+    }
+    state->busy_message = config->busy_message;
+    state->max_queued = config->max_pending;
+    pthread_mutex_init(&state->lock, NULL);
+    pthread_cond_init(&state->ready, NULL);
+
+    state->threads = calloc(config->async_threads, sizeof(pthread_t));
+    if (!state->threads) {
+        free(state);
+        return -1;
+    }
+    for (int i = 0; i < config->async_threads; i++) {
+        if (pthread_create(&state->threads[i], NULL, resolve_worker, state) != 0) {
+            break;
+        }
+        state->thread_count++;
+    }
+    if (state->thread_count == 0) {
+        free(state->threads);
+        free(state);
+        return -1;
+    }
+
+    *state_out = state;
+    return 0;
+}
+
+static HandlerResult resolve_handle(void *arg, HandlerCall *call) {
+    ResolveState *state = arg;
+
+    // Trim surrounding whitespace, e.g. a trailing newline from nc
+    const char *host = call->payload;
+    size_t len = call->len;
+    while (len > 0 && isspace((unsigned char)host[0])) {
+        host++;
+        len--;
+    }
+    while (len > 0 && isspace((unsigned char)host[len - 1])) {
+        len--;
+    }
+    if (len == 0 || len >= RESOLVE_MAX_HOST) {
+        handler_reply(call, "Invalid hostname");
+        return HANDLER_DONE;
+    }
+
+    // Jobs of timed out requests stay queued until a worker reaches them, so the
+    // pending table alone does not bound the queue when lookups are slow
+    pthread_mutex_lock(&state->lock);
+    int full = state->queued >= state->max_queued;
+    pthread_mutex_unlock(&state->lock);
+    if (full) {
+        handler_reply(call, state->busy_message);
+        return HANDLER_DONE;
+    }
+
+    ResolveJob *job = malloc(sizeof(ResolveJob));
+    if (!job) {
+        handler_reply(call, state->busy_message);
+        return HANDLER_DONE;
+    }
+    memcpy(job->host, host, len);
+    job->host[len] = '\0';
+    job->pending = call->pending;
+    job->expires_ms = monotonic_ms() + call->timeout_ms;
+    job->next = NULL;
+
+    if (handler_defer(call, NULL, NULL, &job->token) < 0) {
+        free(job);
+        handler_reply(call, state->busy_message);
+        return HANDLER_DONE;
+    }
+
+    pthread_mutex_lock(&state->lock);
+    if (state->tail) {
+        state->tail->next = job;
+    } else {
+        state->head = job;
+    }
+    state->tail = job;
+    state->queued++;
+    pthread_cond_signal(&state->ready);
+    pthread_mutex_unlock(&state->lock);
+
+    return HANDLER_PENDING;
+}
+
+static void resolve_destroy(void *arg) {
+    ResolveState *state = arg;
+
+    pthread_mutex_lock(&state->lock);
+    state->stopping = 1;
+    pthread_cond_broadcast(&state->ready);
+    pthread_mutex_unlock(&state->lock);
+
+    for (int i = 0; i < state->thread_count; i++) {
+        pthread_join(state->threads[i], NULL);
+    }
+
+    while (state->head) {
+        ResolveJob *next = state->head->next;
+        free(state->head);
+        state->head = next;
+    }
+    pthread_mutex_destroy(&state->lock);
+    pthread_cond_destroy(&state->ready);
+    free(state->threads);
+    free(state);
+}
+
+const RequestHandler resolve_handler = {
+    .name = "resolve",
+    .init = resolve_init,
+    .handle = resolve_handle,
+    .destroy = resolve_destroy
+};
@@ -0,0 +1,237 @@
+#include <stdint.h>
+#include <string.h>
+#include "siphash.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIPHASH_HAVE_X86 1
+#endif
+
+#define ROTL(x, b) (((x) << (b)) | ((x) >> (64 - (b))))
+
+#define SIPROUND(v0, v1, v2, v3) \
+    do { \
+        v0 += v1; v1 = ROTL(v1, 13); v1 ^= v0; v0 = ROTL(v0, 32); \
+        v2 += v3; v3 = ROTL(v3, 16); v3 ^= v2; \
+        v0 += v3; v3 = ROTL(v3, 21); v3 ^= v0; \
+        v2 += v1; v1 = ROTL(v1, 17); v1 ^= v2; v2 = ROTL(v2, 32); \
+    } while (0)
+
+// Four 64-bit lanes; GCC lowers the operators to AVX2, SSE2 or scalar code
+typedef uint64_t u64x4 __attribute__((vector_size(32)));
+typedef uint32_t u32x8 __attribute__((vector_size(32)));
+typedef uint8_t u8x32 __attribute__((vector_size(32)));
+
+// Vector rotations by 32 and 16 are word and byte shuffles, which are much
+// cheaper than the two shifts and an or that AVX2 needs for other counts
+#define ROTL32_X4(x) ((u64x4)__builtin_shuffle((u32x8)(x), (u32x8){ 1, 0, 3, 2, 5, 4, 7, 6 }))
+#define ROTL16_X4(x) ((u64x4)__builtin_shuffle((u8x32)(x), (u8x32){ \
+    6, 7, 0, 1, 2, 3, 4, 5, 14, 15, 8, 9, 10, 11, 12, 13, \
+    22, 23, 16, 17, 18, 19, 20, 21, 30, 31, 24, 25, 26, 27, 28, 29 }))
+
+#define SIPROUND_X4(v0, v1, v2, v3) \
+    do { \
+        v0 += v1; v1 = ROTL(v1, 13); v1 ^= v0; v0 = ROTL32_X4(v0); \
+        v2 += v3; v3 = ROTL16_X4(v3); v3 ^= v2; \
+        v0 += v3; v3 = ROTL(v3, 21); v3 ^= v0; \
+        v2 += v1; v1 = ROTL(v1, 17); v1 ^= v2; v2 = ROTL32_X4(v2); \
+    } while (0)
+
+static uint64_t load_le64(const unsigned char *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+// Last block: the remaining bytes plus the message length in the top byte
+static uint64_t final_block(const unsigned char *data, size_t len) {
+    uint64_t b = (uint64_t)len << 56;
+    const unsigned char *tail = data + (len & ~(size_t)7);
+    for (size_t i = 0; i < (len & 7); i++) {
+        b |= (uint64_t)tail[i] << (8 * i);
+    }
+    return b;
+}
+
+uint64_t siphash24(const SipKey *key, const void *data, size_t len) {
+    const unsigned char *in = data;
+    uint64_t v0 = key->k0 ^ 0x736f6d6570736575ULL;
+    uint64_t v1 = key->k1 ^ 0x646f72616e646f6dULL;
+    uint64_t v2 = key->k0 ^ 0x6c7967656e657261ULL;
+    uint64_t v3 = key->k1 ^ 0x7465646279746573ULL;
+
+    size_t blocks = len / 8;
+    for (size_t i = 0; i < blocks; i++) {
+        uint64_t m = load_le64(in + i * 8);
+        v3 ^= m;
+        SIPROUND(v0, v1, v2, v3);
+        SIPROUND(v0, v1, v2, v3);
+        v0 ^= m;
+    }
+
+    uint64_t b = final_block(in, len);
+    v3 ^= b;
+    SIPROUND(v0, v1, v2, v3);
+    SIPROUND(v0, v1, v2, v3);
+    v0 ^= b;
+
+    v2 ^= 0xff;
+    SIPROUND(v0, v1, v2, v3);
+    SIPROUND(v0, v1, v2, v3);
+    SIPROUND(v0, v1, v2, v3);
+    SIPROUND(v0, v1, v2, v3);
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+// Body shared by the generic and AVX2 builds of siphash24_x4
+static inline __attribute__((always_inline))
+void siphash24_x4_body(const SipKey *const keys[SIPHASH_LANES], const unsigned char *const data[SIPHASH_LANES],
+                       const size_t len[SIPHASH_LANES], uint64_t out[SIPHASH_LANES]) {
+    u64x4 k0 = { keys[0]->k0, keys[1]->k0, keys[2]->k0, keys[3]->k0 };
+    u64x4 k1 = { keys[0]->k1, keys[1]->k1, keys[2]->k1, keys[3]->k1 };
+    u64x4 v0 = k0 ^ 0x736f6d6570736575ULL;
+    u64x4 v1 = k1 ^ 0x646f72616e646f6dULL;
+    u64x4 v2 = k0 ^ 0x6c7967656e657261ULL;
+    u64x4 v3 = k1 ^ 0x7465646279746573ULL;
+
+    // Every lane compresses len / 8 full blocks and then its final block
+    size_t blocks[SIPHASH_LANES];
+    size_t min_blocks = SIZE_MAX;
+    size_t max_blocks = 0;
+    for (int l = 0; l < SIPHASH_LANES; l++) {
+        blocks[l] = len[l] / 8;
+        if (blocks[l] < min_blocks) {
+            min_blocks = blocks[l];
+        }
+        if (blocks[l] + 1 > max_blocks) {
+            max_blocks = blocks[l] + 1;
+        }
+    }
+
+    // Full blocks that all lanes have
+    size_t i = 0;
+    for (; i < min_blocks; i++) {
+        u64x4 m = { load_le64(data[0] + i * 8), load_le64(data[1] + i * 8),
+                    load_le64(data[2] + i * 8), load_le64(data[3] + i * 8) };
+        v3 ^= m;
+        SIPROUND_X4(v0, v1, v2, v3);
+        SIPROUND_X4(v0, v1, v2, v3);
+        v0 ^= m;
+    }
+
+    // Remaining blocks of the longer lanes; finished lanes keep their state
+    for (; i < max_blocks; i++) {
+        u64x4 m;
+        u64x4 active;
+        for (int l = 0; l < SIPHASH_LANES; l++) {
+            if (i < blocks[l]) {
+                m[l] = load_le64(data[l] + i * 8);
+            } else if (i == blocks[l]) {
+                m[l] = final_block(data[l], len[l]);
+            } else {
+                m[l] = 0;
+            }
+            active[l] = i <= blocks[l] ? ~0ULL : 0;
+        }
+
+        u64x4 n0 = v0, n1 = v1, n2 = v2, n3 = v3 ^ m;
+        SIPROUND_X4(n0, n1, n2, n3);
+        SIPROUND_X4(n0, n1, n2, n3);
+        n0 ^= m;
+
+        v0 = (n0 & active) | (v0 & ~active);
+        v1 = (n1 & active) | (v1 & ~active);
+        v2 = (n2 & active) | (v2 & ~active);
+        v3 = (n3 & active) | (v3 & ~active);
+    }
+
+    v2 ^= 0xff;
+    SIPROUND_X4(v0, v1, v2, v3);
+    SIPROUND_X4(v0, v1, v2, v3);
+    SIPROUND_X4(v0, v1, v2, v3);
+    SIPROUND_X4(v0, v1, v2, v3);
+    u64x4 tag = v0 ^ v1 ^ v2 ^ v3;
+    for (int l = 0; l < SIPHASH_LANES; l++) {
+        out[l] = tag[l];
+    }
+}
+
+static void siphash24_x4_generic(const SipKey *const keys[SIPHASH_LANES],
+                                 const unsigned char *const data[SIPHASH_LANES],
+                                 const size_t len[SIPHASH_LANES], uint64_t out[SIPHASH_LANES]) {
+    siphash24_x4_body(keys, data, len, out);
+}
+
+#ifdef SIPHASH_HAVE_X86
+__attribute__((target("avx2")))
+static void siphash24_x4_avx2(const SipKey *const keys[SIPHASH_LANES],
+                              const unsigned char *const data[SIPHASH_LANES],
+                              const size_t len[SIPHASH_LANES], uint64_t out[SIPHASH_LANES]) {
+    siphash24_x4_body(keys, data, len, out);
+}
+#endif
+
+// -1 until the first call checks the CPU
+static int use_avx2 = -1;
+
+static void select_impl(void) {
+    use_avx2 = 0;
+#ifdef SIPHASH_HAVE_X86
+    __builtin_cpu_init();
+    use_avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+#endif
+}
+
+void siphash24_x4(const SipKey *const keys[SIPHASH_LANES], const unsigned char *const data[SIPHASH_LANES],
+                  const size_t len[SIPHASH_LANES], uint64_t out[SIPHASH_LANES]) {
+    if (use_avx2 < 0) {
+        select_impl();
+    }
+#ifdef SIPHASH_HAVE_X86
+    if (use_avx2) {
+        siphash24_x4_avx2(keys, data, len, out);
+        return;
+    }
+#endif
+    siphash24_x4_generic(keys, data, len, out);
+}
+
+const char *siphash_x4_impl(void) {
+    if (use_avx2 < 0) {
+        select_impl();
+    }
+    return use_avx2 ? "avx2" : "generic";
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+int sip_key_from_hex(const char *hex, SipKey *key) {
+    unsigned char bytes[16];
+    if (strlen(hex) != 32) {
+        return -1;
+    }
+    for (int i = 0; i < 16; i++) {
+        int hi = hex_value(hex[2 * i]);
+        int lo = hex_value(hex[2 * i + 1]);
+        if (hi < 0 || lo < 0) {
+            return -1;
+        }
+        bytes[i] = (unsigned char)(hi << 4 | lo);
+    }
+    key->k0 = load_le64(bytes);
+    key->k1 = load_le64(bytes + 8);
+    return 0;
+}
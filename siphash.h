@@ -0,0 +1,57 @@
+#ifndef SIPHASH_H
+#define SIPHASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Messages hashed together by siphash24_x4
+#define SIPHASH_LANES 4
+
+/**
+ * 128-bit SipHash key; k0 and k1 are the little-endian halves of the key bytes
+ */
+typedef struct {
+    uint64_t k0;
+    uint64_t k1;
+} SipKey;
+
+/**
+ * SipHash-2-4 of one message
+ *
+ * @param key Key
+ * @param data Message
+ * @param len Message length
+ * @return 64-bit tag
+ */
+uint64_t siphash24(const SipKey *key, const void *data, size_t len);
+
+/**
+ * SipHash-2-4 of four messages at once. The lanes run interleaved in one
+ * set of 4x64-bit vectors (AVX2 when the CPU has it); lanes whose message
+ * ended keep their state while longer lanes finish.
+ *
+ * @param keys Key of each lane
+ * @param data Message of each lane
+ * @param len Message length of each lane
+ * @param out Tag of each lane
+ */
+void siphash24_x4(const SipKey *const keys[SIPHASH_LANES], const unsigned char *const data[SIPHASH_LANES],
+                  const size_t len[SIPHASH_LANES], uint64_t out[SIPHASH_LANES]);
+
+/**
+ * Parse a key written as 32 hex digits
+ *
+ * @param hex Key text
+ * @param key Parsed key
+ * @return 0 on success, -1 if the text is not 32 hex digits
+ */
+int sip_key_from_hex(const char *hex, SipKey *key);
+
+/**
+ * Name of the siphash24_x4 implementation selected for the running CPU
+ *
+ * @return "avx2" or "generic"
+ */
+const char *siphash_x4_impl(void);
+
+#endif /* SIPHASH_H */
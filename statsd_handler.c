@@ -0,0 +1,390 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "handler.h"
+
+// StatsD ingestion handler. Each datagram carries one or more lines of
+// "name:value|type[|@rate][|#tags]" with type c (counter), g (gauge, a
+// leading +/- makes it a delta), ms or h (timer). Samples are aggregated
+// in memory and written as JSON lines every flush interval; nothing is
+// sent back to the client.
+
+#define STATSD_MAX_NAME 200
+#define STATSD_OUTPUT_BUFFER (1 << 20)
+
+// Timer percentiles come from a log-bucketed sketch with 1% relative error.
+// Sketches with the same bucket layout merge by adding bucket counts.
+#define STATSD_SKETCH_ALPHA 0.01
+#define STATSD_SKETCH_BUCKETS 1536
+// Bucket 0 holds values around e^-8; the last one values around e^22
+#define STATSD_SKETCH_OFFSET 400
+
+typedef enum {
+    STATSD_COUNTER = 0,
+    STATSD_GAUGE,
+    STATSD_TIMER
+} StatsdType;
+
+typedef struct {
+    char name[STATSD_MAX_NAME + 1];
+    size_t name_len;
+    uint64_t hash;
+    StatsdType type;
+    int in_use;
+    int updated;
+
+    // Counter sum or gauge value
+    double value;
+
+    // Timer aggregates
+    double count;
+    double sum;
+    double min;
+    double max;
+    uint32_t *sketch;
+    uint64_t sketch_zero;
+    uint64_t sketch_total;
+} StatsdMetric;
+
+typedef struct {
+    StatsdMetric *metrics;
+    uint32_t mask;
+    uint32_t metric_count;
+    uint32_t max_metrics;
+
+    FILE *output;
+    char *output_buffer;
+    uint64_t flush_interval_ms;
+    uint64_t last_flush_ms;
+    double log_gamma;
+
+    uint64_t lines;
+    uint64_t bad_lines;
+    uint64_t dropped;
+    uint64_t flushes;
+    uint64_t rows;
+} StatsdState;
+
+static uint32_t round_up_pow2(uint32_t value) {
+    uint32_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+static void sketch_add(StatsdState *state, StatsdMetric *metric, double value) {
+    metric->sketch_total++;
+    if (value <= 0.0) {
+        metric->sketch_zero++;
+        return;
+    }
+    long index = (long)ceil(log(value) / state->log_gamma) + STATSD_SKETCH_OFFSET;
+    if (index < 0) {
+        index = 0;
+    } else if (index >= STATSD_SKETCH_BUCKETS) {
+        index = STATSD_SKETCH_BUCKETS - 1;
+    }
+    metric->sketch[index]++;
+}
+
+static double sketch_quantile(const StatsdState *state, const StatsdMetric *metric, double q) {
+    if (metric->sketch_total == 0) {
+        return 0.0;
+    }
+    uint64_t rank = (uint64_t)(q * (double)(metric->sketch_total - 1));
+    uint64_t seen = metric->sketch_zero;
+    if (seen > rank) {
+        return 0.0;
+    }
+    for (int i = 0; i < STATSD_SKETCH_BUCKETS; i++) {
+        seen += metric->sketch[i];
+        if (seen > rank) {
+            // Midpoint of the bucket (gamma^(i-1), gamma^i] in relative terms
+            double gamma = exp(state->log_gamma);
+            return 2.0 * exp((double)(i - STATSD_SKETCH_OFFSET) * state->log_gamma) / (gamma + 1.0);
+        }
+    }
+    return metric->max;
+}
+
+// Find or create the entry for a metric; returns NULL when the table is full
+static StatsdMetric *find_metric(StatsdState *state, const char *name, size_t len, uint64_t hash,
+                                 StatsdType type) {
+    uint32_t slot = (uint32_t)hash & state->mask;
+    while (state->metrics[slot].in_use) {
+        StatsdMetric *metric = &state->metrics[slot];
+        if (metric->hash == hash && metric->type == type && metric->name_len == len &&
+            memcmp(metric->name, name, len) == 0) {
+            return metric;
+        }
+        slot = (slot + 1) & state->mask;
+    }
+
+    if (state->metric_count >= state->max_metrics) {
+        return NULL;
+    }
+    StatsdMetric *metric = &state->metrics[slot];
+    if (type == STATSD_TIMER) {
+        metric->sketch = calloc(STATSD_SKETCH_BUCKETS, sizeof(uint32_t));
+        if (!metric->sketch) {
+            return NULL;
+        }
+    }
+    memcpy(metric->name, name, len);
+    metric->name[len] = '\0';
+    metric->name_len = len;
+    metric->hash = hash;
+    metric->type = type;
+    metric->in_use = 1;
+    state->metric_count++;
+    return metric;
+}
+
+// Parse and aggregate one line; returns 0 on success, -1 if malformed
+static int parse_line(StatsdState *state, const char *line, const char *end) {
+    // Name: hash while scanning and reject characters that would need JSON escaping
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    const char *p = line;
+    while (p < end && *p != ':') {
+        unsigned char c = (unsigned char)*p;
+        if (c < 0x20 || c == '"' || c == '\\' || c == '|') {
+            return -1;
+        }
+        hash ^= c;
+        hash *= 0x100000001b3ULL;
+        p++;
+    }
+    size_t name_len = (size_t)(p - line);
+    if (p == end || name_len == 0 || name_len > STATSD_MAX_NAME) {
+        return -1;
+    }
+    p++;
+
+    // The datagram is NUL-terminated, so strtod cannot run past the buffer
+    int signed_value = p < end && (*p == '+' || *p == '-');
+    char *value_end;
+    double value = strtod(p, &value_end);
+    if (value_end == p || value_end >= end || *value_end != '|' || !isfinite(value)) {
+        return -1;
+    }
+    p = value_end + 1;
+
+    StatsdType type;
+    if (end - p >= 1 && *p == 'c' && (p + 1 == end || p[1] == '|')) {
+        type = STATSD_COUNTER;
+        p += 1;
+    } else if (end - p >= 1 && *p == 'g' && (p + 1 == end || p[1] == '|')) {
+        type = STATSD_GAUGE;
+        p += 1;
+    } else if (end - p >= 2 && p[0] == 'm' && p[1] == 's' && (p + 2 == end || p[2] == '|')) {
+        type = STATSD_TIMER;
+        p += 2;
+    } else if (end - p >= 1 && *p == 'h' && (p + 1 == end || p[1] == '|')) {
+        type = STATSD_TIMER;
+        p += 1;
+    } else {
+        return -1;
+    }
+
+    double rate = 1.0;
+    while (p < end && *p == '|') {
+        p++;
+        if (p < end && *p == '@') {
+            char *rate_end;
+            rate = strtod(p + 1, &rate_end);
+            // The next line of the datagram follows end, so strtod can read past this line
+            if (rate_end == p + 1 || rate_end > end || (rate_end != end && *rate_end != '|') ||
+                rate <= 0.0 || rate > 1.0) {
+                return -1;
+            }
+            p = rate_end;
+        } else {
+            // Tags and unknown fields are ignored
+            while (p < end && *p != '|') {
+                p++;
+            }
+        }
+    }
+
+    StatsdMetric *metric = find_metric(state, line, name_len, hash, type);
+    if (!metric) {
+        state->dropped++;
+        return 0;
+    }
+    metric->updated = 1;
+
+    switch (type) {
+        case STATSD_COUNTER:
+            metric->value += value / rate;
+            break;
+        case STATSD_GAUGE:
+            metric->value = signed_value ? metric->value + value : value;
+            break;
+        case STATSD_TIMER:
+            if (metric->count == 0.0 || value < metric->min) {
+                metric->min = value;
+            }
+            if (metric->count == 0.0 || value > metric->max) {
+                metric->max = value;
+            }
+            metric->count += 1.0 / rate;
+            metric->sum += value;
+            sketch_add(state, metric, value);
+            break;
+    }
+    return 0;
+}
+
+// Write one row per metric updated since the last flush and reset the interval state
+static void flush_metrics(StatsdState *state, uint64_t now_ms) {
+    double interval = (double)(now_ms - state->last_flush_ms) / 1000.0;
+    long long timestamp = (long long)time(NULL);
+    state->last_flush_ms = now_ms;
+    state->flushes++;
+
+    for (uint32_t slot = 0; slot <= state->mask; slot++) {
+        StatsdMetric *metric = &state->metrics[slot];
+        if (!metric->in_use || !metric->updated) {
+            continue;
+        }
+        metric->updated = 0;
+
+        switch (metric->type) {
+            case STATSD_COUNTER:
+                fprintf(state->output,
+                        "{\"timestamp\":%lld,\"name\":\"%s\",\"type\":\"counter\",\"value\":%.17g,\"rate\":%.17g}\n",
+                        timestamp, metric->name, metric->value,
+                        interval > 0.0 ? metric->value / interval : 0.0);
+                metric->value = 0.0;
+                break;
+            case STATSD_GAUGE:
+                // Gauges keep their value so later deltas apply to it
+                fprintf(state->output,
+                        "{\"timestamp\":%lld,\"name\":\"%s\",\"type\":\"gauge\",\"value\":%.17g}\n",
+                        timestamp, metric->name, metric->value);
+                break;
+            case STATSD_TIMER:
+                fprintf(state->output,
+                        "{\"timestamp\":%lld,\"name\":\"%s\",\"type\":\"timer\",\"count\":%.17g,"
+                        "\"sum\":%.17g,\"min\":%.17g,\"max\":%.17g,\"mean\":%.17g,"
+                        "\"p50\":%.6g,\"p90\":%.6g,\"p99\":%.6g}\n",
+                        timestamp, metric->name, metric->count, metric->sum, metric->min, metric->max,
+                        metric->sketch_total ? metric->sum / (double)metric->sketch_total : 0.0,
+                        sketch_quantile(state, metric, 0.50),
+                        sketch_quantile(state, metric, 0.90),
+                        sketch_quantile(state, metric, 0.99));
+                metric->count = 0.0;
+                metric->sum = 0.0;
+                metric->sketch_zero = 0;
+                metric->sketch_total = 0;
+                memset(metric->sketch, 0, STATSD_SKETCH_BUCKETS * sizeof(uint32_t));
+                break;
+        }
+        state->rows++;
+    }
+    fflush(state->output);
+}
+
+static HandlerResult statsd_handle(void *arg, HandlerCall *call) {
+    StatsdState *state = arg;
+    const char *p = call->payload;
+    const char *end = call->payload + call->len;
+
+    while (p < end) {
+        const char *line_end = memchr(p, '\n', (size_t)(end - p));
+        if (!line_end) {
+            line_end = end;
+        }
+        const char *trimmed = line_end;
+        if (trimmed > p && trimmed[-1] == '\r') {
+            trimmed--;
+        }
+        if (trimmed > p) {
+            state->lines++;
+            if (parse_line(state, p, trimmed) < 0) {
+                state->bad_lines++;
+            }
+        }
+        p = line_end + 1;
+    }
+    return HANDLER_DROP;
+}
+
+static void statsd_tick(void *arg, uint64_t now_ms) {
+    StatsdState *state = arg;
+    if (now_ms - state->last_flush_ms >= state->flush_interval_ms) {
+        flush_metrics(state, now_ms);
+    }
+}
+
+static void statsd_report(void *arg, ServerMetrics *metrics) {
+    StatsdState *state = arg;
+    metrics->statsd_enabled = 1;
+    metrics->statsd_lines = state->lines;
+    metrics->statsd_bad_lines = state->bad_lines;
+    metrics->statsd_metrics = state->metric_count;
+    metrics->statsd_dropped = state->dropped;
+    metrics->statsd_flushes = state->flushes;
+    metrics->statsd_rows = state->rows;
+}
+
+static void statsd_destroy(void *arg) {
+    StatsdState *state = arg;
+    if (state->output) {
+        flush_metrics(state, monotonic_ms());
+        fclose(state->output);
+    }
+    if (state->metrics) {
+        for (uint32_t slot = 0; slot <= state->mask; slot++) {
+            free(state->metrics[slot].sketch);
+        }
+    }
+    free(state->metrics);
+    free(state->output_buffer);
+    free(state);
+}
+
+static int statsd_init(const ServerConfig *config, void **state_out) {
+    StatsdState *state = calloc(1, sizeof(StatsdState));
+    if (!state) {
+        return -1;
+    }
+
+    state->max_metrics = config->statsd_max_metrics;
+    uint32_t slots = round_up_pow2(state->max_metrics * 2);
+    state->mask = slots - 1;
+    state->metrics = calloc(slots, sizeof(StatsdMetric));
+    state->output_buffer = malloc(STATSD_OUTPUT_BUFFER);
+    if (!state->metrics || !state->output_buffer) {
+        statsd_destroy(state);
+        return -1;
+    }
+
+    state->output = fopen(config->statsd_output_file, "a");
+    if (!state->output) {
+        perror("Error opening statsd output file");
+        statsd_destroy(state);
+        return -1;
+    }
+    setvbuf(state->output, state->output_buffer, _IOFBF, STATSD_OUTPUT_BUFFER);
+
+    state->flush_interval_ms = (uint64_t)config->statsd_flush_interval * 1000;
+    state->last_flush_ms = monotonic_ms();
+    state->log_gamma = log((1.0 + STATSD_SKETCH_ALPHA) / (1.0 - STATSD_SKETCH_ALPHA));
+
+    *state_out = state;
+    return 0;
+}
+
+const RequestHandler statsd_handler = {
+    .name = "statsd",
+    .init = statsd_init,
+    .handle = statsd_handle,
+    .destroy = statsd_destroy,
+    .tick = statsd_tick,
+    .report = statsd_report,
+    .quiet = 1
+};
@@ -0,0 +1,340 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include "handler.h"
+#include "log_sink.h"
+
+// Syslog collector handler. RFC 5424 and RFC 3164 headers are parsed in
+// place and every message becomes one JSON line appended to the log sink;
+// nothing is sent back to the client.
+
+// Facility user, severity notice: the RFC 3164 default for messages without PRI
+#define SYSLOG_DEFAULT_PRI 13
+
+typedef enum {
+    SYSLOG_RAW = 0,
+    SYSLOG_RFC3164,
+    SYSLOG_RFC5424
+} SyslogFormat;
+
+/**
+ * Slice of the received datagram
+ */
+typedef struct {
+    const char *data;
+    size_t len;
+} SyslogField;
+
+typedef struct {
+    SyslogFormat format;
+    int pri;
+    SyslogField timestamp;
+    SyslogField host;
+    SyslogField app;
+    SyslogField procid;
+    SyslogField msgid;
+    SyslogField structured_data;
+    SyslogField message;
+} SyslogMessage;
+
+typedef struct {
+    LogSink sink;
+    char *record;
+    size_t record_size;
+    uint64_t messages;
+    uint64_t formats[3];
+} SyslogState;
+
+static const char *format_names[] = { "raw", "rfc3164", "rfc5424" };
+
+// Read a space-terminated header field; "-" is the RFC 5424 nil value
+static SyslogField next_field(const char **p, const char *end) {
+    SyslogField field = { *p, 0 };
+    while (*p < end && **p != ' ') {
+        (*p)++;
+    }
+    field.len = (size_t)(*p - field.data);
+    if (*p < end) {
+        (*p)++;
+    }
+    if (field.len == 1 && field.data[0] == '-') {
+        field.len = 0;
+    }
+    return field;
+}
+
+// Skip RFC 5424 structured data: "-" or one or more [id param="value"] elements
+static SyslogField next_structured_data(const char **p, const char *end) {
+    SyslogField field = { *p, 0 };
+    if (*p < end && **p == '-') {
+        (*p)++;
+    } else {
+        while (*p < end && **p == '[') {
+            int quoted = 0;
+            (*p)++;
+            while (*p < end && (quoted || **p != ']')) {
+                if (**p == '\\' && *p + 1 < end) {
+                    (*p)++;
+                } else if (**p == '"') {
+                    quoted = !quoted;
+                }
+                (*p)++;
+            }
+            if (*p < end) {
+                (*p)++;
+            }
+        }
+        field.len = (size_t)(*p - field.data);
+    }
+    if (*p < end && **p == ' ') {
+        (*p)++;
+    }
+    return field;
+}
+
+static int is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static void parse_rfc3164(const char *p, const char *end, SyslogMessage *msg) {
+    // "Mmm dd hh:mm:ss HOST TAG[PID]: MSG"
+    if (end - p >= 16 && p[3] == ' ' && p[6] == ' ' && p[9] == ':' && p[12] == ':' && p[15] == ' ') {
+        msg->timestamp.data = p;
+        msg->timestamp.len = 15;
+        p += 16;
+        msg->host = next_field(&p, end);
+
+        const char *tag = p;
+        while (p < end && *p != ':' && *p != '[' && *p != ' ') {
+            p++;
+        }
+        msg->app.data = tag;
+        msg->app.len = (size_t)(p - tag);
+        if (p < end && *p == '[') {
+            const char *pid = ++p;
+            while (p < end && *p != ']') {
+                p++;
+            }
+            msg->procid.data = pid;
+            msg->procid.len = (size_t)(p - pid);
+            if (p < end) {
+                p++;
+            }
+        }
+        if (p < end && *p == ':') {
+            p++;
+        }
+        if (p < end && *p == ' ') {
+            p++;
+        }
+    }
+    msg->message.data = p;
+    msg->message.len = (size_t)(end - p);
+}
+
+static void parse_syslog(const char *data, size_t len, SyslogMessage *msg) {
+    const char *p = data;
+    const char *end = data + len;
+    memset(msg, 0, sizeof(SyslogMessage));
+    msg->format = SYSLOG_RAW;
+    msg->pri = SYSLOG_DEFAULT_PRI;
+
+    while (end > p && (end[-1] == '\n' || end[-1] == '\r' || end[-1] == '\0')) {
+        end--;
+    }
+
+    if (p < end && *p == '<') {
+        const char *q = p + 1;
+        int pri = 0;
+        int digits = 0;
+        while (q < end && is_digit(*q) && digits < 3) {
+            pri = pri * 10 + (*q - '0');
+            q++;
+            digits++;
+        }
+        if (digits > 0 && q < end && *q == '>' && pri <= 191) {
+            msg->pri = pri;
+            msg->format = SYSLOG_RFC3164;
+            p = q + 1;
+        }
+    }
+
+    // RFC 5424 puts a version number right after PRI
+    if (msg->format == SYSLOG_RFC3164 && end - p >= 2 && is_digit(p[0]) && p[1] == ' ') {
+        msg->format = SYSLOG_RFC5424;
+        p += 2;
+        msg->timestamp = next_field(&p, end);
+        msg->host = next_field(&p, end);
+        msg->app = next_field(&p, end);
+        msg->procid = next_field(&p, end);
+        msg->msgid = next_field(&p, end);
+        msg->structured_data = next_structured_data(&p, end);
+        if (end - p >= 3 && (unsigned char)p[0] == 0xEF && (unsigned char)p[1] == 0xBB &&
+            (unsigned char)p[2] == 0xBF) {
+            p += 3;
+        }
+        msg->message.data = p;
+        msg->message.len = (size_t)(end - p);
+    } else if (msg->format == SYSLOG_RFC3164) {
+        parse_rfc3164(p, end, msg);
+    } else {
+        msg->message.data = p;
+        msg->message.len = (size_t)(end - p);
+    }
+}
+
+// Append text with JSON escaping; stops early rather than overrun the record
+static size_t append_escaped(char *out, size_t pos, size_t size, const char *data, size_t len) {
+    static const char hex[] = "0123456789abcdef";
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)data[i];
+        if (c == '"' || c == '\\') {
+            if (pos + 2 > size) {
+                break;
+            }
+            out[pos++] = '\\';
+            out[pos++] = (char)c;
+        } else if (c < 0x20) {
+            if (pos + 6 > size) {
+                break;
+            }
+            memcpy(out + pos, "\\u00", 4);
+            out[pos + 4] = hex[c >> 4];
+            out[pos + 5] = hex[c & 0xf];
+            pos += 6;
+        } else {
+            if (pos + 1 > size) {
+                break;
+            }
+            out[pos++] = (char)c;
+        }
+    }
+    return pos;
+}
+
+static size_t append_raw(char *out, size_t pos, size_t size, const char *text) {
+    size_t len = strlen(text);
+    if (pos + len > size) {
+        len = size - pos;
+    }
+    memcpy(out + pos, text, len);
+    return pos + len;
+}
+
+static size_t append_field(char *out, size_t pos, size_t size, const char *name, SyslogField field) {
+    if (field.len == 0) {
+        return pos;
+    }
+    pos = append_raw(out, pos, size, ",\"");
+    pos = append_raw(out, pos, size, name);
+    pos = append_raw(out, pos, size, "\":\"");
+    pos = append_escaped(out, pos, size, field.data, field.len);
+    return append_raw(out, pos, size, "\"");
+}
+
+static HandlerResult syslog_handle(void *arg, HandlerCall *call) {
+    SyslogState *state = arg;
+    SyslogMessage msg;
+    parse_syslog(call->payload, call->len, &msg);
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    char client_ip[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &call->client->sin_addr, client_ip, sizeof(client_ip));
+
+    // Keep room for the closing "}\n" so truncated records stay valid JSON
+    char *out = state->record;
+    size_t size = state->record_size - 3;
+    int written = snprintf(out, size,
+                           "{\"received_ms\":%lld,\"source\":\"%s\",\"format\":\"%s\",\"facility\":%d,\"severity\":%d",
+                           (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000, client_ip,
+                           format_names[msg.format], msg.pri >> 3, msg.pri & 7);
+    size_t pos = written > 0 ? (size_t)written : 0;
+    if (pos > size) {
+        pos = size;
+    }
+    pos = append_field(out, pos, size, "timestamp", msg.timestamp);
+    pos = append_field(out, pos, size, "host", msg.host);
+    pos = append_field(out, pos, size, "app", msg.app);
+    pos = append_field(out, pos, size, "procid", msg.procid);
+    pos = append_field(out, pos, size, "msgid", msg.msgid);
+    pos = append_field(out, pos, size, "structured_data", msg.structured_data);
+    pos = append_raw(out, pos, size, ",\"message\":\"");
+    pos = append_escaped(out, pos, size, msg.message.data, msg.message.len);
+    out[pos++] = '"';
+    out[pos++] = '}';
+    out[pos++] = '\n';
+
+    state->messages++;
+    state->formats[msg.format]++;
+    log_sink_append(&state->sink, out, pos);
+    return HANDLER_DROP;
+}
+
+static void syslog_tick(void *arg, uint64_t now_ms) {
+    SyslogState *state = arg;
+    log_sink_tick(&state->sink, now_ms);
+}
+
+static void syslog_report(void *arg, ServerMetrics *metrics) {
+    SyslogState *state = arg;
+    LogSink *sink = &state->sink;
+    metrics->syslog_enabled = 1;
+    metrics->syslog_messages = state->messages;
+    metrics->syslog_rfc5424 = state->formats[SYSLOG_RFC5424];
+    metrics->syslog_rfc3164 = state->formats[SYSLOG_RFC3164];
+    metrics->syslog_raw = state->formats[SYSLOG_RAW];
+    metrics->syslog_dropped = sink->dropped_records;
+    metrics->syslog_appended_bytes = sink->appended_bytes;
+
+    pthread_mutex_lock(&sink->lock);
+    metrics->syslog_bytes_written = sink->bytes_written;
+    metrics->syslog_writes = sink->writes;
+    metrics->syslog_segments = sink->segments;
+    metrics->syslog_write_errors = sink->write_errors;
+    pthread_mutex_unlock(&sink->lock);
+}
+
+static void syslog_destroy(void *arg) {
+    SyslogState *state = arg;
+    log_sink_free(&state->sink);
+    free(state->record);
+    free(state);
+}
+
+static int syslog_init(const ServerConfig *config, void **state_out) {
+    SyslogState *state = calloc(1, sizeof(SyslogState));
+    if (!state) {
+        return -1;
+    }
+    if (log_sink_init(&state->sink, config, monotonic_ms()) < 0) {
+        free(state);
+        return -1;
+    }
+
+    // Worst case every payload byte is escaped to \u00XX, plus the header fields
+    state->record_size = (size_t)config->buffer_size * 6 + 1024;
+    if (state->record_size > state->sink.buffer_size - SINK_BLOCK_SIZE) {
+        state->record_size = state->sink.buffer_size - SINK_BLOCK_SIZE;
+    }
+    state->record = malloc(state->record_size);
+    if (!state->record) {
+        syslog_destroy(state);
+        return -1;
+    }
+
+    *state_out = state;
+    return 0;
+}
+
+const RequestHandler syslog_handler = {
+    .name = "syslog",
+    .init = syslog_init,
+    .handle = syslog_handle,
+    .destroy = syslog_destroy,
+    .tick = syslog_tick,
+    .report = syslog_report,
+    .quiet = 1
+};
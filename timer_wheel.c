@@ -0,0 +1,151 @@
+#include "timer_wheel.h"
+
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SLOTS - 1)
+
+static void list_init(TimerNode *head) {
+    head->next = head;
+    head->prev = head;
+}
+
+static void list_append(TimerNode *head, TimerNode *node) {
+    node->prev = head->prev;
+    node->next = head;
+    head->prev->next = node;
+    head->prev = node;
+}
+
+static void list_unlink(TimerNode *node) {
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->next = NULL;
+    node->prev = NULL;
+}
+
+// Place a node in the finest level whose span covers its remaining delay
+static void place_timer(TimerWheel *wheel, TimerNode *node) {
+    uint64_t delta = node->expires - wheel->now;
+    int level = 0;
+
+    while (level < TIMER_WHEEL_LEVELS - 1 &&
+           delta >= (1ULL << (TIMER_WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+
+    unsigned int index = (unsigned int)(node->expires >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK;
+    list_append(&wheel->slots[level][index], node);
+}
+
+void timer_wheel_init(TimerWheel *wheel, uint64_t now_ms) {
+    wheel->now = now_ms;
+    wheel->count = 0;
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        for (int i = 0; i < TIMER_WHEEL_SLOTS; i++) {
+            list_init(&wheel->slots[level][i]);
+        }
+    }
+}
+
+void timer_wheel_add(TimerWheel *wheel, TimerNode *node, uint64_t expires_ms) {
+    // The slot for wheel->now has already fired, so the earliest deadline is the next tick
+    if (expires_ms <= wheel->now) {
+        expires_ms = wheel->now + 1;
+    } else if (expires_ms - wheel->now > TIMER_WHEEL_MAX_DELAY) {
+        expires_ms = wheel->now + TIMER_WHEEL_MAX_DELAY;
+    }
+
+    node->expires = expires_ms;
+    place_timer(wheel, node);
+    wheel->count++;
+}
+
+void timer_wheel_remove(TimerWheel *wheel, TimerNode *node) {
+    if (timer_wheel_armed(node)) {
+        list_unlink(node);
+        wheel->count--;
+    }
+}
+
+int timer_wheel_armed(const TimerNode *node) {
+    return node->next != NULL;
+}
+
+// Move every node of a coarse slot down to the level matching its remaining delay
+static void cascade(TimerWheel *wheel, int level, unsigned int index) {
+    TimerNode pending;
+    TimerNode *head = &wheel->slots[level][index];
+
+    if (head->next == head) {
+        return;
+    }
+
+    // Detach the whole slot first; re-placed nodes may land in the same slot again
+    pending.next = head->next;
+    pending.prev = head->prev;
+    pending.next->prev = &pending;
+    pending.prev->next = &pending;
+    list_init(head);
+
+    while (pending.next != &pending) {
+        TimerNode *node = pending.next;
+        list_unlink(node);
+        place_timer(wheel, node);
+    }
+}
+
+uint64_t timer_wheel_next_expiry(const TimerWheel *wheel) {
+    if (wheel->count == 0) {
+        return UINT64_MAX;
+    }
+
+    // Coarser levels are pulled down when the finest level wraps
+    uint64_t next_cascade = (wheel->now | TIMER_WHEEL_MASK) + 1;
+    for (uint64_t tick = wheel->now + 1; tick < next_cascade; tick++) {
+        const TimerNode *head = &wheel->slots[0][tick & TIMER_WHEEL_MASK];
+        if (head->next != head) {
+            return tick;
+        }
+    }
+    return next_cascade;
+}
+
+size_t timer_wheel_advance(TimerWheel *wheel, uint64_t now_ms, TimerCallback callback, void *arg) {
+    size_t fired = 0;
+
+    // Nothing armed: jump straight to the present instead of walking idle ticks
+    if (wheel->count == 0) {
+        if (now_ms > wheel->now) {
+            wheel->now = now_ms;
+        }
+        return 0;
+    }
+
+    while (wheel->now < now_ms) {
+        wheel->now++;
+        uint64_t tick = wheel->now;
+        unsigned int index = (unsigned int)tick & TIMER_WHEEL_MASK;
+
+        // Each time a level wraps, pull the next slot of the level above down
+        for (int level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+            if (((tick >> (TIMER_WHEEL_BITS * (level - 1))) & TIMER_WHEEL_MASK) != 0) {
+                break;
+            }
+            cascade(wheel, level, (unsigned int)(tick >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK);
+        }
+
+        TimerNode *head = &wheel->slots[0][index];
+        while (head->next != head) {
+            TimerNode *node = head->next;
+            list_unlink(node);
+            wheel->count--;
+            fired++;
+            callback(node, arg);
+        }
+
+        if (wheel->count == 0) {
+            wheel->now = now_ms;
+            break;
+        }
+    }
+
+    return fired;
+}
@@ -0,0 +1,91 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 4 levels of 64 slots at 1ms resolution cover ~4.6 hours
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS 4
+#define TIMER_WHEEL_MAX_DELAY ((1ULL << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) - 1)
+
+/**
+ * Intrusive timer node, embedded in the object that owns the timer
+ */
+typedef struct TimerNode {
+    struct TimerNode *next;
+    struct TimerNode *prev;
+    uint64_t expires;
+} TimerNode;
+
+/**
+ * Hierarchical timer wheel with millisecond ticks.
+ * Timers further out than one level live in coarser slots and are
+ * cascaded down as the wheel turns, so add/remove are O(1).
+ */
+typedef struct {
+    uint64_t now;
+    size_t count;
+    TimerNode slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+} TimerWheel;
+
+/**
+ * Callback invoked for each expired timer; the node is already unlinked
+ */
+typedef void (*TimerCallback)(TimerNode *node, void *arg);
+
+/**
+ * Initialize an empty wheel
+ *
+ * @param wheel Wheel to initialize
+ * @param now_ms Current time in milliseconds
+ */
+void timer_wheel_init(TimerWheel *wheel, uint64_t now_ms);
+
+/**
+ * Arm a timer. Deadlines in the past fire on the next tick.
+ *
+ * @param wheel Timer wheel
+ * @param node Unlinked timer node
+ * @param expires_ms Absolute deadline in milliseconds
+ */
+void timer_wheel_add(TimerWheel *wheel, TimerNode *node, uint64_t expires_ms);
+
+/**
+ * Disarm a timer if it is linked
+ *
+ * @param wheel Timer wheel
+ * @param node Timer node
+ */
+void timer_wheel_remove(TimerWheel *wheel, TimerNode *node);
+
+/**
+ * Check whether a timer is armed
+ *
+ * @param node Timer node
+ * @return 1 if the node is linked into a wheel slot
+ */
+int timer_wheel_armed(const TimerNode *node);
+
+/**
+ * Earliest tick at which a timer can fire. Exact for timers in the finest
+ * level; timers in coarser levels are bounded by the next cascade.
+ *
+ * @param wheel Timer wheel
+ * @return Tick in milliseconds, or UINT64_MAX if no timer is armed
+ */
+uint64_t timer_wheel_next_expiry(const TimerWheel *wheel);
+
+/**
+ * Advance the wheel to now_ms and fire every expired timer
+ *
+ * @param wheel Timer wheel
+ * @param now_ms Current time in milliseconds
+ * @param callback Function invoked for each expired node
+ * @param arg Argument passed to the callback
+ * @return Number of timers fired
+ */
+size_t timer_wheel_advance(TimerWheel *wheel, uint64_t now_ms, TimerCallback callback, void *arg);
+
+#endif /* TIMER_WHEEL_H */
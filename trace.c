@@ -0,0 +1,277 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "trace.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TRACE_HAVE_TSC 1
+#include <x86intrin.h>
+#endif
+
+static const char *stage_names[] = {
+    "recv", "auth", "filter", "log", "log_flush", "handler", "send",
+    "pending", "tick", "metrics", "sink_write", "resolve"
+};
+
+typedef struct {
+    uint64_t start;
+    uint64_t end;
+    TraceStage stage;
+} TraceSpan;
+
+/**
+ * Spans of one thread. Only the owning thread writes; head is published
+ * with release ordering so a dump can tell which slots were overwritten
+ * while it was copying.
+ */
+typedef struct {
+    char name[32];
+    int tid;
+    TraceSpan *spans;
+    uint64_t head;
+    uint64_t countdown;
+    TraceStageStats stats[TRACE_STAGE_COUNT];
+} TraceRing;
+
+int trace_enabled = 0;
+__thread int trace_sampled = 0;
+static __thread TraceRing *thread_ring = NULL;
+
+static pthread_mutex_t rings_lock = PTHREAD_MUTEX_INITIALIZER;
+static TraceRing *rings[TRACE_MAX_THREADS];
+static int ring_count = 0;
+static uint64_t ring_size = 0;
+static uint64_t sample_every = 1;
+static uint64_t origin = 0;
+static double ticks_per_ns = 1.0;
+
+static uint64_t clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+uint64_t trace_clock(void) {
+#ifdef TRACE_HAVE_TSC
+    return __rdtsc();
+#else
+    return clock_ns();
+#endif
+}
+
+// Measure the TSC rate against the monotonic clock
+static void calibrate(void) {
+#ifdef TRACE_HAVE_TSC
+    struct timespec pause = { 0, 20 * 1000 * 1000 };
+    uint64_t ns0 = clock_ns();
+    uint64_t t0 = trace_clock();
+    nanosleep(&pause, NULL);
+    uint64_t ns1 = clock_ns();
+    uint64_t t1 = trace_clock();
+    if (ns1 > ns0 && t1 > t0) {
+        ticks_per_ns = (double)(t1 - t0) / (double)(ns1 - ns0);
+    }
+#else
+    ticks_per_ns = 1.0;
+#endif
+}
+
+int trace_init(const ServerConfig *config) {
+    if (!config->trace_enabled) {
+        return 0;
+    }
+    ring_size = (uint64_t)config->trace_ring_size;
+    sample_every = (uint64_t)config->trace_sample_every;
+    calibrate();
+    origin = trace_clock();
+    trace_enabled = 1;
+    return 0;
+}
+
+void trace_thread_start(const char *name) {
+    if (!trace_enabled || thread_ring) {
+        return;
+    }
+
+    TraceRing *ring = calloc(1, sizeof(TraceRing));
+    if (!ring) {
+        return;
+    }
+    ring->spans = calloc(ring_size, sizeof(TraceSpan));
+    if (!ring->spans) {
+        free(ring);
+        return;
+    }
+    strncpy(ring->name, name, sizeof(ring->name) - 1);
+
+    pthread_mutex_lock(&rings_lock);
+    if (ring_count < TRACE_MAX_THREADS) {
+        ring->tid = ring_count + 1;
+        rings[ring_count++] = ring;
+        thread_ring = ring;
+    }
+    pthread_mutex_unlock(&rings_lock);
+
+    if (!thread_ring) {
+        free(ring->spans);
+        free(ring);
+    }
+}
+
+void trace_sample_next(void) {
+    TraceRing *ring = thread_ring;
+    if (!ring) {
+        trace_sampled = 0;
+    } else if (ring->countdown == 0) {
+        trace_sampled = 1;
+        ring->countdown = sample_every - 1;
+    } else {
+        trace_sampled = 0;
+        ring->countdown--;
+    }
+}
+
+void trace_record(TraceStage stage, uint64_t start) {
+    uint64_t end = trace_clock();
+    TraceRing *ring = thread_ring;
+    if (!ring) {
+        return;
+    }
+
+    TraceSpan *span = &ring->spans[ring->head % ring_size];
+    span->start = start;
+    span->end = end;
+    span->stage = stage;
+    __atomic_store_n(&ring->head, ring->head + 1, __ATOMIC_RELEASE);
+
+    // Single writer; relaxed stores keep concurrent readers of the totals well defined
+    TraceStageStats *stats = &ring->stats[stage];
+    uint64_t cycles = end - start;
+    __atomic_store_n(&stats->count, stats->count + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&stats->cycles, stats->cycles + cycles, __ATOMIC_RELAXED);
+    if (cycles > stats->max_cycles) {
+        __atomic_store_n(&stats->max_cycles, cycles, __ATOMIC_RELAXED);
+    }
+}
+
+double trace_ticks_to_ns(uint64_t ticks) {
+    return (double)ticks / ticks_per_ns;
+}
+
+const char *trace_stage_name(TraceStage stage) {
+    if (stage < TRACE_RECV || stage >= TRACE_STAGE_COUNT) {
+        return "unknown";
+    }
+    return stage_names[stage];
+}
+
+void trace_stage_stats(TraceStageStats stats[TRACE_STAGE_COUNT]) {
+    memset(stats, 0, sizeof(TraceStageStats) * TRACE_STAGE_COUNT);
+
+    pthread_mutex_lock(&rings_lock);
+    for (int r = 0; r < ring_count; r++) {
+        for (int s = 0; s < TRACE_STAGE_COUNT; s++) {
+            const TraceStageStats *ring_stats = &rings[r]->stats[s];
+            uint64_t max_cycles = __atomic_load_n(&ring_stats->max_cycles, __ATOMIC_RELAXED);
+            stats[s].count += __atomic_load_n(&ring_stats->count, __ATOMIC_RELAXED);
+            stats[s].cycles += __atomic_load_n(&ring_stats->cycles, __ATOMIC_RELAXED);
+            if (max_cycles > stats[s].max_cycles) {
+                stats[s].max_cycles = max_cycles;
+            }
+        }
+    }
+    pthread_mutex_unlock(&rings_lock);
+}
+
+// Chrome trace timestamps are microseconds since the trace origin
+static double ticks_to_us(uint64_t ticks) {
+    return trace_ticks_to_ns(ticks) / 1000.0;
+}
+
+// Write the spans that survived the copy; returns the number written
+static uint64_t write_ring(FILE *fp, const TraceRing *ring, TraceSpan *copy, int pid, int *first) {
+    uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    uint64_t begin = head > ring_size ? head - ring_size : 0;
+    for (uint64_t i = begin; i < head; i++) {
+        copy[i - begin] = ring->spans[i % ring_size];
+    }
+
+    // Slots the owner reused during the copy may hold torn spans, and the slot at
+    // head may be mid-write; skip them
+    uint64_t after = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    uint64_t valid = after >= ring_size ? after - ring_size + 1 : 0;
+    if (valid < begin) {
+        valid = begin;
+    }
+
+    fprintf(fp, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+            *first ? "" : ",", pid, ring->tid, ring->name);
+    *first = 0;
+
+    uint64_t written = 0;
+    for (uint64_t i = valid; i < head; i++) {
+        const TraceSpan *span = &copy[i - begin];
+        if (span->start < origin || span->end < span->start) {
+            continue;
+        }
+        fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"udp_server\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,"
+                "\"ts\":%.3f,\"dur\":%.3f}",
+                stage_names[span->stage], pid, ring->tid,
+                ticks_to_us(span->start - origin), ticks_to_us(span->end - span->start));
+        written++;
+    }
+    return written;
+}
+
+int trace_dump(const char *path, FILE *out) {
+    if (!trace_enabled) {
+        return 0;
+    }
+
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        perror("Cannot open trace file");
+        return -1;
+    }
+    TraceSpan *copy = malloc(ring_size * sizeof(TraceSpan));
+    if (!copy) {
+        perror("Memory allocation failed");
+        fclose(fp);
+        return -1;
+    }
+
+    int pid = (int)getpid();
+    int first = 1;
+    uint64_t written = 0;
+    fprintf(fp, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    pthread_mutex_lock(&rings_lock);
+    for (int r = 0; r < ring_count; r++) {
+        written += write_ring(fp, rings[r], copy, pid, &first);
+    }
+    pthread_mutex_unlock(&rings_lock);
+    fprintf(fp, "\n]}\n");
+    free(copy);
+    if (fclose(fp) != 0) {
+        perror("Failed to write trace file");
+        return -1;
+    }
+
+    // Totals cover every sampled span since startup, not only those still in the rings
+    TraceStageStats stats[TRACE_STAGE_COUNT];
+    trace_stage_stats(stats);
+    fprintf(out, "%-12s %12s %12s %12s %12s\n", "stage", "spans", "total ms", "avg ns", "max ns");
+    for (int s = 0; s < TRACE_STAGE_COUNT; s++) {
+        if (stats[s].count == 0) {
+            continue;
+        }
+        fprintf(out, "%-12s %12llu %12.3f %12.0f %12.0f\n", stage_names[s],
+                (unsigned long long)stats[s].count,
+                trace_ticks_to_ns(stats[s].cycles) / 1e6,
+                trace_ticks_to_ns(stats[s].cycles) / (double)stats[s].count,
+                trace_ticks_to_ns(stats[s].max_cycles));
+    }
+    fflush(out);
+    return (int)written;
+}
@@ -0,0 +1,138 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "udp_server.h"
+
+// Threads that can record spans
+#define TRACE_MAX_THREADS 64
+
+/**
+ * Processing stages recorded as spans
+ */
+typedef enum {
+    TRACE_RECV = 0,     // recvmmsg
+    TRACE_AUTH,         // batch tag verification
+    TRACE_FILTER,       // payload filter
+    TRACE_LOG,          // payload printing and log formatting
+    TRACE_LOG_FLUSH,    // fflush of the log file (inside log)
+    TRACE_HANDLER,      // request handler
+    TRACE_SEND,         // sendmmsg
+    TRACE_PENDING,      // deferred request expiry and completion
+    TRACE_TICK,         // handler and overload periodic work
+    TRACE_METRICS,      // metrics snapshot
+    TRACE_SINK_WRITE,   // log sink pwritev (writer thread)
+    TRACE_RESOLVE,      // hostname lookup (resolve workers)
+    TRACE_STAGE_COUNT
+} TraceStage;
+
+/**
+ * Accumulated cost of one stage
+ */
+typedef struct {
+    uint64_t count;
+    uint64_t cycles;
+    uint64_t max_cycles;
+} TraceStageStats;
+
+// Set by trace_init when tracing is configured
+extern int trace_enabled;
+// Whether the current unit of work of this thread is sampled
+extern __thread int trace_sampled;
+
+/**
+ * Decide whether the next unit of work of this thread (a loop iteration,
+ * a worker job) is sampled. Costs a load and a branch when tracing is off.
+ */
+#define TRACE_SAMPLE() \
+    do { \
+        if (trace_enabled) { \
+            trace_sample_next(); \
+        } \
+    } while (0)
+
+/**
+ * Start a span; the variable holds 0 when the unit is not sampled
+ */
+#define TRACE_BEGIN(var) uint64_t var = trace_sampled ? trace_clock() : 0
+
+/**
+ * Record the span started with TRACE_BEGIN
+ */
+#define TRACE_END(stage, var) \
+    do { \
+        if (var) { \
+            trace_record(stage, var); \
+        } \
+    } while (0)
+
+/**
+ * Calibrate the clock and enable tracing when the tracing section asks for it
+ *
+ * @param config Server configuration
+ * @return 0 on success, -1 on error
+ */
+int trace_init(const ServerConfig *config);
+
+/**
+ * Give the calling thread its span ring; threads without one record nothing
+ *
+ * @param name Thread name shown in the trace viewer
+ */
+void trace_thread_start(const char *name);
+
+/**
+ * Sampling decision behind TRACE_SAMPLE
+ */
+void trace_sample_next(void);
+
+/**
+ * Current time in clock ticks (TSC cycles on x86)
+ *
+ * @return Tick count
+ */
+uint64_t trace_clock(void);
+
+/**
+ * Append a span ending now to the ring of the calling thread
+ *
+ * @param stage Stage
+ * @param start Start tick from TRACE_BEGIN
+ */
+void trace_record(TraceStage stage, uint64_t start);
+
+/**
+ * Write the spans of all threads as Chrome/Perfetto trace JSON and print
+ * the per-stage cost table
+ *
+ * @param path Output file
+ * @param out Stream for the cost table
+ * @return Number of spans written, or -1 on error
+ */
+int trace_dump(const char *path, FILE *out);
+
+/**
+ * Per-stage totals over all threads
+ *
+ * @param stats Output, one entry per stage
+ */
+void trace_stage_stats(TraceStageStats stats[TRACE_STAGE_COUNT]);
+
+/**
+ * Convert clock ticks to nanoseconds
+ *
+ * @param ticks Tick count
+ * @return Nanoseconds
+ */
+double trace_ticks_to_ns(uint64_t ticks);
+
+/**
+ * Name of a stage
+ *
+ * @param stage Stage
+ * @return Name string
+ */
+const char *trace_stage_name(TraceStage stage);
+
+#endif /* TRACE_H */
@@ -6,6 +6,9 @@ ClientConfig init_client_config(void) {
     config.server_port = 8888;              // Default port
     config.timeout_seconds = DEFAULT_CLIENT_TIMEOUT;
     config.buffer_size = DEFAULT_CLIENT_BUFFER_SIZE;
+    config.auth_enabled = 0;
+    config.auth_key_id = 0;
+    memset(&config.auth_key, 0, sizeof(config.auth_key));
     return config;
 }
 
@@ -20,6 +23,14 @@ int set_server_address(ClientConfig *config, const char *ip, int port) {
     return 0;
 }
 
+int set_auth_key(ClientConfig *config, const char *spec) {
+    if (!config || !spec || auth_parse_key(spec, &config->auth_key_id, &config->auth_key) < 0) {
+        return -1;
+    }
+    config->auth_enabled = 1;
+    return 0;
+}
+
 int create_client_socket(void) {
     return socket(AF_INET, SOCK_DGRAM, 0);
 }
@@ -50,10 +61,27 @@ ssize_t send_and_receive(int sockfd, const ClientConfig *config,
         return -1;
     }
 
+    // Wrap the message in an authenticated frame when a key is set
+    const char *datagram = message;
+    size_t datagram_len = strlen(message);
+    char *frame = NULL;
+    if (config->auth_enabled) {
+        size_t frame_size = datagram_len + AUTH_OVERHEAD;
+        frame = malloc(frame_size);
+        if (!frame) {
+            perror("Memory allocation failed");
+            return -1;
+        }
+        datagram_len = auth_sign(&config->auth_key, config->auth_key_id, message, datagram_len,
+                                 frame, frame_size);
+        datagram = frame;
+    }
+
     // Send message to server
-    ssize_t sent = sendto(sockfd, message, strlen(message), 0,
+    ssize_t sent = sendto(sockfd, datagram, datagram_len, 0,
                          (const struct sockaddr *)&server_addr,
                          sizeof(server_addr));
+    free(frame);
     if (sent < 0) {
         perror("Send failed");
         return -1;
@@ -72,10 +100,23 @@ ssize_t send_and_receive(int sockfd, const ClientConfig *config,
 }
 
 int main(int argc, char *argv[]) {
-    // Parse command line arguments
+    // Parse command line arguments: [-k id:key] [ip] [port] [message]
     const char *server_ip = "127.0.0.1";  // Default to localhost
     int server_port = 8888;               // Default port
     const char *message = "Hello, UDP Server!"; // Default message
+    const char *auth_key = NULL;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "k:")) != -1) {
+        if (opt == 'k') {
+            auth_key = optarg;
+        } else {
+            fprintf(stderr, "Usage: %s [-k id:key] [server_ip] [port] [message]\n", argv[0]);
+            return 1;
+        }
+    }
+    argc -= optind - 1;
+    argv += optind - 1;
 
     if (argc > 1) {
         server_ip = argv[1];
@@ -96,6 +137,10 @@ int main(int argc, char *argv[]) {
     // Initialize client configuration
     ClientConfig config = init_client_config();
     set_server_address(&config, server_ip, server_port);
+    if (auth_key && set_auth_key(&config, auth_key) < 0) {
+        fprintf(stderr, "Invalid authentication key (expected id:32 hex digits)\n");
+        return 1;
+    }
 
     // Create socket
     int sockfd = create_client_socket();
@@ -9,6 +9,7 @@
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <errno.h>
+#include "auth_frame.h"
 
 // Default client settings
 #define DEFAULT_CLIENT_TIMEOUT 5  // seconds
@@ -22,6 +23,9 @@ typedef struct {
     int server_port;
     int timeout_seconds;
     int buffer_size;
+    int auth_enabled;       // sign messages with auth_key
+    uint8_t auth_key_id;
+    SipKey auth_key;
 } ClientConfig;
 
 /**
@@ -41,6 +45,15 @@ ClientConfig init_client_config(void);
  */
 int set_server_address(ClientConfig *config, const char *ip, int port);
 
+/**
+ * Sign outgoing messages with an authentication key
+ *
+ * @param config Client configuration
+ * @param spec Key as "id:32 hex digits", the format of the server's auth.keys
+ * @return 0 on success, -1 on a malformed key
+ */
+int set_auth_key(ClientConfig *config, const char *spec);
+
 /**
  * Create a UDP socket for client
  *
@@ -58,7 +71,8 @@ int create_client_socket(void);
 int set_socket_timeout(int sockfd, int seconds);
 
 /**
- * Send message to server and get response
+ * Send message to server and get response; the message is signed when
+ * an authentication key is set
  *
  * @param sockfd Socket file descriptor
  * @param config Client configuration
@@ -0,0 +1,721 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <math.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include "udp_netem.h"
+#include "addr_utils.h"
+
+// Socket buffers sized for bursts of a million datagrams per second
+#define NETEM_SOCKET_BUFFER (8 * 1024 * 1024)
+
+// Set by SIGINT/SIGTERM; the relay loop prints its counters and exits
+static volatile sig_atomic_t stop_requested = 0;
+
+static void request_stop(int sig) {
+    (void)sig;
+    stop_requested = 1;
+}
+
+static const char *distribution_names[] = { "uniform", "normal", "pareto" };
+
+// Parse a number within [min, max]
+static int parse_number(const char *text, double min, double max, double *value) {
+    char *end;
+    double parsed = strtod(text, &end);
+    if (end == text || *end != '\0' || parsed < min || parsed > max) {
+        return -1;
+    }
+    *value = parsed;
+    return 0;
+}
+
+int netem_parse_args(NetemConfig *config, int argc, char *argv[]) {
+    memset(config, 0, sizeof(*config));
+    config->max_size = NETEM_DEFAULT_MAX_SIZE;
+    config->pool_size = NETEM_DEFAULT_POOL;
+    config->batch_size = NETEM_DEFAULT_BATCH;
+    config->max_flows = NETEM_DEFAULT_MAX_FLOWS;
+    config->params.queue_limit = NETEM_DEFAULT_QUEUE_LIMIT;
+    config->params.distribution = NETEM_DIST_UNIFORM;
+    config->seed = (uint64_t)time(NULL) ^ ((uint64_t)getpid() << 32);
+
+    int have_target = 0;
+    double value;
+    int opt;
+    while ((opt = getopt(argc, argv, "l:t:L:B:d:j:D:p:r:R:q:m:b:P:F:s:")) != -1) {
+        switch (opt) {
+        case 'l':
+            if (parse_number(optarg, 1, 65535, &value) < 0) {
+                return -1;
+            }
+            config->listen_port = (int)value;
+            break;
+        case 't':
+            if (parse_ipv4_endpoint(optarg, &config->target) < 0) {
+                fprintf(stderr, "Invalid target %s (expected a.b.c.d:port)\n", optarg);
+                return -1;
+            }
+            have_target = 1;
+            break;
+        case 'L':
+            if (parse_number(optarg, 0, 100, &value) < 0) {
+                return -1;
+            }
+            config->params.loss = value / 100.0;
+            break;
+        case 'B':
+            if (parse_number(optarg, 0, 1e6, &value) < 0) {
+                return -1;
+            }
+            config->params.loss_burst = value;
+            break;
+        case 'd':
+            if (parse_number(optarg, 0, 60000, &value) < 0) {
+                return -1;
+            }
+            config->params.delay_us = value * 1000.0;
+            break;
+        case 'j':
+            if (parse_number(optarg, 0, 60000, &value) < 0) {
+                return -1;
+            }
+            config->params.jitter_us = value * 1000.0;
+            break;
+        case 'D':
+            if (strcmp(optarg, "uniform") == 0) {
+                config->params.distribution = NETEM_DIST_UNIFORM;
+            } else if (strcmp(optarg, "normal") == 0) {
+                config->params.distribution = NETEM_DIST_NORMAL;
+            } else if (strcmp(optarg, "pareto") == 0) {
+                config->params.distribution = NETEM_DIST_PARETO;
+            } else {
+                fprintf(stderr, "Unknown delay distribution %s\n", optarg);
+                return -1;
+            }
+            break;
+        case 'p':
+            if (parse_number(optarg, 0, 100, &value) < 0) {
+                return -1;
+            }
+            config->params.duplicate = value / 100.0;
+            break;
+        case 'r':
+            if (parse_number(optarg, 0, 100, &value) < 0) {
+                return -1;
+            }
+            config->params.reorder = value / 100.0;
+            break;
+        case 'R':
+            if (parse_number(optarg, 0, 1e6, &value) < 0) {
+                return -1;
+            }
+            config->params.rate_bps = value * 1e6;
+            break;
+        case 'q':
+            if (parse_number(optarg, 1, 1e7, &value) < 0) {
+                return -1;
+            }
+            config->params.queue_limit = (uint32_t)value;
+            break;
+        case 'm':
+            if (parse_number(optarg, 64, 65535, &value) < 0) {
+                return -1;
+            }
+            config->max_size = (int)value;
+            break;
+        case 'b':
+            if (parse_number(optarg, 1, 1024, &value) < 0) {
+                return -1;
+            }
+            config->batch_size = (int)value;
+            break;
+        case 'P':
+            if (parse_number(optarg, 16, 1 << 24, &value) < 0) {
+                return -1;
+            }
+            config->pool_size = (int)value;
+            break;
+        case 'F':
+            if (parse_number(optarg, 1, 1 << 20, &value) < 0) {
+                return -1;
+            }
+            config->max_flows = (int)value;
+            break;
+        case 's':
+            config->seed = strtoull(optarg, NULL, 0);
+            break;
+        default:
+            return -1;
+        }
+    }
+
+    if (config->listen_port == 0 || !have_target) {
+        return -1;
+    }
+    return 0;
+}
+
+void netem_print_stats(const Netem *netem, FILE *out) {
+    static const char *names[] = { "upstream", "downstream" };
+    fprintf(out, "%-10s %12s %12s %10s %10s %10s %10s %10s %10s\n", "direction", "received", "forwarded",
+            "lost", "duplicated", "reordered", "queue_drop", "pool_drop", "send_err");
+    for (int d = 0; d < 2; d++) {
+        const NetemDirection *dir = &netem->directions[d];
+        fprintf(out, "%-10s %12llu %12llu %10llu %10llu %10llu %10llu %10llu %10llu\n", names[d],
+                (unsigned long long)dir->received, (unsigned long long)dir->forwarded,
+                (unsigned long long)dir->lost, (unsigned long long)dir->duplicated,
+                (unsigned long long)dir->reordered, (unsigned long long)dir->queue_drops,
+                (unsigned long long)dir->pool_drops, (unsigned long long)dir->send_errors);
+    }
+    if (netem->flow_drops > 0) {
+        fprintf(out, "Dropped %llu datagrams: flow table full\n", (unsigned long long)netem->flow_drops);
+    }
+    fflush(out);
+}
+
+#ifdef __linux__
+#include <sys/epoll.h>
+
+#define NETEM_MAX_EVENTS 64
+// Batches read from one socket per wakeup, so the listener cannot starve the flow sockets
+#define NETEM_MAX_DRAIN 8
+// epoll timeout with nothing due; bounds signal and idle sweep latency
+#define NETEM_IDLE_WAIT_MS 100
+// epoll_wait sleeps in whole milliseconds, so deadlines closer than this are polled
+#define NETEM_SPIN_US 1000
+#define NETEM_SWEEP_US 1000000ULL
+#define NETEM_TAG_LISTENER UINT64_MAX
+
+static uint64_t netem_now_us(const Netem *netem) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000 - netem->origin_us;
+}
+
+// xorshift64*; plenty for impairment decisions and cheap enough per datagram
+static double random_uniform(Netem *netem) {
+    uint64_t x = netem->rng;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    netem->rng = x;
+    return (double)((x * 0x2545f4914f6cdd1dULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static void set_socket_buffers(int fd) {
+    int size = NETEM_SOCKET_BUFFER;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+}
+
+static NetemPacket *packet_alloc(Netem *netem) {
+    NetemPacket *packet = netem->free_list;
+    if (packet) {
+        netem->free_list = packet->next_free;
+    }
+    return packet;
+}
+
+static void packet_free(Netem *netem, NetemPacket *packet) {
+    netem->flows[packet->flow].inflight--;
+    packet->next_free = netem->free_list;
+    netem->free_list = packet;
+}
+
+// Gilbert-Elliott: every datagram in the bad state is lost and the state
+// lasts loss_burst datagrams on average; the long-run loss rate stays at loss
+static int lose_datagram(Netem *netem, NetemDirection *dir) {
+    const NetemParams *params = &netem->config.params;
+    if (params->loss <= 0.0) {
+        return 0;
+    }
+    if (params->loss >= 1.0) {
+        return 1;
+    }
+    if (params->loss_burst <= 1.0) {
+        return random_uniform(netem) < params->loss;
+    }
+
+    double u = random_uniform(netem);
+    if (dir->bad_state) {
+        if (u < 1.0 / params->loss_burst) {
+            dir->bad_state = 0;
+        }
+    } else if (u < params->loss / (params->loss_burst * (1.0 - params->loss))) {
+        dir->bad_state = 1;
+    }
+    return dir->bad_state;
+}
+
+static double sample_delay(Netem *netem) {
+    const NetemParams *params = &netem->config.params;
+    double delay = params->delay_us;
+    if (params->jitter_us <= 0.0) {
+        return delay;
+    }
+
+    switch (params->distribution) {
+    case NETEM_DIST_NORMAL: {
+        // Box-Muller; 1 - u keeps the logarithm finite
+        double u1 = 1.0 - random_uniform(netem);
+        double u2 = random_uniform(netem);
+        delay += params->jitter_us * sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+        break;
+    }
+    case NETEM_DIST_PARETO:
+        // Shape 2: the tail added to the delay has mean jitter and unbounded variance
+        delay += params->jitter_us * (1.0 / sqrt(1.0 - random_uniform(netem)) - 1.0);
+        break;
+    default:
+        delay += params->jitter_us * (2.0 * random_uniform(netem) - 1.0);
+        break;
+    }
+    return delay > 0.0 ? delay : 0.0;
+}
+
+// Send what is batched for one direction through one socket and return the packets to the pool
+static void output_send(Netem *netem, int direction, int fd) {
+    NetemOutput *out = &netem->outputs[direction];
+    unsigned int count = out->batch.count;
+    if (count == 0) {
+        return;
+    }
+
+    int sent = send_batch_flush(fd, &out->batch);
+    netem->directions[direction].forwarded += sent;
+    netem->directions[direction].send_errors += count - sent;
+    for (unsigned int i = 0; i < count; i++) {
+        packet_free(netem, out->packets[i]);
+    }
+}
+
+static void output_add(Netem *netem, int direction, int fd, const struct sockaddr_in *addr, NetemPacket *packet) {
+    NetemOutput *out = &netem->outputs[direction];
+    if (out->batch.count >= out->batch.size) {
+        output_send(netem, direction, fd);
+    }
+    out->packets[out->batch.count] = packet;
+    send_batch_add_ref(&out->batch, addr, packet->data, packet->len);
+}
+
+// Queue a due packet. Downstream packets all leave through the listening socket; upstream
+// packets leave through their flow's socket, so they are collected per flow until the flush.
+static void output_queue(Netem *netem, NetemPacket *packet) {
+    if (packet->direction == NETEM_DOWNSTREAM) {
+        output_add(netem, NETEM_DOWNSTREAM, netem->listen_fd,
+                   &netem->flow_table.entries[packet->flow].client, packet);
+        return;
+    }
+
+    NetemFlow *flow = &netem->flows[packet->flow];
+    packet->next_due = NULL;
+    if (flow->due_tail) {
+        flow->due_tail->next_due = packet;
+    } else {
+        flow->due_head = packet;
+        netem->due_flows[netem->due_flow_count++] = packet->flow;
+    }
+    flow->due_tail = packet;
+}
+
+// Send all due packets: one sendmmsg per flow with due upstream packets, then the downstream batch
+static void output_flush(Netem *netem) {
+    for (uint32_t i = 0; i < netem->due_flow_count; i++) {
+        uint32_t index = netem->due_flows[i];
+        NetemFlow *flow = &netem->flows[index];
+        int fd = netem->flow_table.entries[index].fd;
+        for (NetemPacket *packet = flow->due_head; packet; packet = packet->next_due) {
+            output_add(netem, NETEM_UPSTREAM, fd, &netem->config.target, packet);
+        }
+        flow->due_head = NULL;
+        flow->due_tail = NULL;
+        output_send(netem, NETEM_UPSTREAM, fd);
+    }
+    netem->due_flow_count = 0;
+    output_send(netem, NETEM_DOWNSTREAM, netem->listen_fd);
+}
+
+static void packet_due(TimerNode *node, void *arg) {
+    Netem *netem = arg;
+    NetemPacket *packet = (NetemPacket *)node;
+    netem->directions[packet->direction].queued--;
+    output_queue(netem, packet);
+}
+
+// Run one received datagram through loss, duplication, the rate limit and the delay
+static void impair(Netem *netem, int direction, uint32_t flow, const char *data, size_t len, uint64_t now_us) {
+    const NetemParams *params = &netem->config.params;
+    NetemDirection *dir = &netem->directions[direction];
+
+    dir->received++;
+    if (lose_datagram(netem, dir)) {
+        dir->lost++;
+        return;
+    }
+
+    int copies = 1;
+    if (params->duplicate > 0.0 && random_uniform(netem) < params->duplicate) {
+        copies = 2;
+        dir->duplicated++;
+    }
+
+    for (int c = 0; c < copies; c++) {
+        if (dir->queued >= params->queue_limit) {
+            dir->queue_drops++;
+            continue;
+        }
+        NetemPacket *packet = packet_alloc(netem);
+        if (!packet) {
+            dir->pool_drops++;
+            continue;
+        }
+        memcpy(packet->data, data, len);
+        packet->len = (uint32_t)len;
+        packet->flow = flow;
+        packet->direction = direction;
+        netem->flows[flow].inflight++;
+
+        // The link serializes datagrams back to back at the configured rate
+        uint64_t due_us = now_us;
+        if (params->rate_bps > 0.0) {
+            uint64_t start_us = dir->link_free_us > now_us ? dir->link_free_us : now_us;
+            dir->link_free_us = start_us + (uint64_t)((double)len * 8.0 * 1e6 / params->rate_bps);
+            due_us = dir->link_free_us;
+        }
+        if (params->reorder > 0.0 && random_uniform(netem) < params->reorder) {
+            dir->reordered++;
+        } else {
+            due_us += (uint64_t)sample_delay(netem);
+        }
+
+        uint64_t tick = (due_us + NETEM_TICK_US - 1) / NETEM_TICK_US;
+        if (tick <= netem->wheel.now) {
+            output_queue(netem, packet);
+        } else {
+            timer_wheel_add(&netem->wheel, &packet->timer, tick);
+            dir->queued++;
+        }
+    }
+}
+
+static void flow_close(Netem *netem, uint32_t index) {
+    flow_table_close(&netem->flow_table, index);
+    if (netem->last_flow == index) {
+        netem->last_flow = FLOW_NONE;
+    }
+}
+
+static uint32_t flow_create(Netem *netem, const struct sockaddr_in *client, uint64_t now_us) {
+    uint32_t index = flow_table_open(&netem->flow_table, client, &netem->config.target);
+    if (index == FLOW_NONE) {
+        return FLOW_NONE;
+    }
+    int fd = netem->flow_table.entries[index].fd;
+    set_socket_buffers(fd);
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.u64 = index;
+    if (epoll_ctl(netem->epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+        flow_table_close(&netem->flow_table, index);
+        return FLOW_NONE;
+    }
+
+    netem->flows[index].inflight = 0;
+    netem->flows[index].last_active_us = now_us;
+    return index;
+}
+
+static uint32_t flow_for_client(Netem *netem, const struct sockaddr_in *client, uint64_t now_us) {
+    // Load generators usually send runs of datagrams from one socket
+    uint32_t index = netem->last_flow;
+    if (index == FLOW_NONE || !same_ipv4_endpoint(&netem->flow_table.entries[index].client, client)) {
+        index = flow_table_lookup(&netem->flow_table, client);
+        if (index == FLOW_NONE) {
+            index = flow_create(netem, client, now_us);
+            if (index == FLOW_NONE) {
+                return FLOW_NONE;
+            }
+        }
+        netem->last_flow = index;
+    }
+    netem->flows[index].last_active_us = now_us;
+    return index;
+}
+
+// Close flows that have been idle and hold no delayed datagrams
+static void sweep_flows(Netem *netem, uint64_t now_us) {
+    for (uint32_t i = 0; i < netem->flow_table.capacity; i++) {
+        NetemFlow *flow = &netem->flows[i];
+        if (netem->flow_table.entries[i].in_use && flow->inflight == 0 && now_us - flow->last_active_us >= NETEM_FLOW_IDLE_US) {
+            flow_close(netem, i);
+        }
+    }
+}
+
+static void receive_clients(Netem *netem, uint64_t now_us) {
+    RecvBatch *batch = &netem->batch;
+    for (int round = 0; round < NETEM_MAX_DRAIN; round++) {
+        int count = recv_batch(netem->listen_fd, batch);
+        if (count <= 0) {
+            break;
+        }
+        for (int i = 0; i < count; i++) {
+            uint32_t flow = flow_for_client(netem, &batch->addrs[i], now_us);
+            if (flow == FLOW_NONE) {
+                netem->flow_drops++;
+                continue;
+            }
+            impair(netem, NETEM_UPSTREAM, flow, recv_batch_payload(batch, i), batch->msgs[i].msg_len, now_us);
+        }
+        if ((unsigned int)count < batch->size) {
+            break;
+        }
+    }
+}
+
+static void receive_target(Netem *netem, uint32_t index, uint64_t now_us) {
+    RecvBatch *batch = &netem->batch;
+    for (int round = 0; round < NETEM_MAX_DRAIN; round++) {
+        // ECONNREFUSED while the target is down is reported here; keep the flow
+        int count = recv_batch(netem->flow_table.entries[index].fd, batch);
+        if (count <= 0) {
+            break;
+        }
+        for (int i = 0; i < count; i++) {
+            impair(netem, NETEM_DOWNSTREAM, index, recv_batch_payload(batch, i), batch->msgs[i].msg_len, now_us);
+        }
+        netem->flows[index].last_active_us = now_us;
+        if ((unsigned int)count < batch->size) {
+            break;
+        }
+    }
+}
+
+// Sleep until shortly before the next delayed datagram is due, then poll
+static int wait_timeout(const Netem *netem, uint64_t now_us) {
+    uint64_t next = timer_wheel_next_expiry(&netem->wheel);
+    if (next == UINT64_MAX) {
+        return NETEM_IDLE_WAIT_MS;
+    }
+    uint64_t due_us = next * NETEM_TICK_US;
+    if (due_us <= now_us + NETEM_SPIN_US) {
+        return 0;
+    }
+    uint64_t wait_ms = (due_us - now_us - NETEM_SPIN_US) / 1000;
+    return wait_ms < NETEM_IDLE_WAIT_MS ? (int)wait_ms : NETEM_IDLE_WAIT_MS;
+}
+
+int netem_init(Netem *netem, const NetemConfig *config) {
+    memset(netem, 0, sizeof(*netem));
+    netem->config = *config;
+    netem->listen_fd = -1;
+    netem->epoll_fd = -1;
+    netem->rng = config->seed ? config->seed : 1;
+    netem->last_flow = FLOW_NONE;
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    netem->origin_us = (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000;
+
+    // Packet pool: one slab of fixed-size data slots threaded on a free list
+    netem->packets = calloc(config->pool_size, sizeof(NetemPacket));
+    netem->packet_data = malloc((size_t)config->pool_size * config->max_size);
+    netem->flows = calloc(config->max_flows, sizeof(NetemFlow));
+    netem->due_flows = calloc(config->max_flows, sizeof(uint32_t));
+    if (!netem->packets || !netem->packet_data || !netem->flows || !netem->due_flows ||
+        flow_table_init(&netem->flow_table, (uint32_t)config->max_flows) < 0 ||
+        recv_batch_init(&netem->batch, config->batch_size, config->max_size) < 0) {
+        perror("Memory allocation failed");
+        return -1;
+    }
+    for (int d = 0; d < 2; d++) {
+        NetemOutput *out = &netem->outputs[d];
+        out->packets = calloc(config->batch_size, sizeof(NetemPacket *));
+        // Datagrams are referenced in the pool; the batch copy buffers stay unused
+        if (!out->packets || send_batch_init(&out->batch, config->batch_size, 1) < 0) {
+            perror("Memory allocation failed");
+            return -1;
+        }
+    }
+    for (int i = config->pool_size - 1; i >= 0; i--) {
+        netem->packets[i].data = netem->packet_data + (size_t)i * config->max_size;
+        netem->packets[i].next_free = netem->free_list;
+        netem->free_list = &netem->packets[i];
+    }
+    timer_wheel_init(&netem->wheel, 0);
+
+    netem->listen_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    netem->epoll_fd = epoll_create1(0);
+    if (netem->listen_fd < 0 || netem->epoll_fd < 0) {
+        perror("Socket setup failed");
+        return -1;
+    }
+    fcntl(netem->listen_fd, F_SETFL, fcntl(netem->listen_fd, F_GETFL) | O_NONBLOCK);
+    set_socket_buffers(netem->listen_fd);
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(config->listen_port);
+    if (bind(netem->listen_fd, (const struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("Bind failed");
+        return -1;
+    }
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.u64 = NETEM_TAG_LISTENER;
+    if (epoll_ctl(netem->epoll_fd, EPOLL_CTL_ADD, netem->listen_fd, &event) < 0) {
+        perror("epoll_ctl failed");
+        return -1;
+    }
+    return 0;
+}
+
+int netem_run(Netem *netem) {
+    struct epoll_event events[NETEM_MAX_EVENTS];
+    uint64_t next_sweep_us = NETEM_SWEEP_US;
+
+    while (!stop_requested) {
+        int ready = epoll_wait(netem->epoll_fd, events, NETEM_MAX_EVENTS,
+                               wait_timeout(netem, netem_now_us(netem)));
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("epoll_wait failed");
+            return -1;
+        }
+
+        // Release what fell due first, so new datagrams scheduled for now go out behind it
+        uint64_t now_us = netem_now_us(netem);
+        timer_wheel_advance(&netem->wheel, now_us / NETEM_TICK_US, packet_due, netem);
+
+        for (int e = 0; e < ready; e++) {
+            uint64_t tag = events[e].data.u64;
+            if (tag == NETEM_TAG_LISTENER) {
+                receive_clients(netem, now_us);
+            } else if (tag < netem->flow_table.capacity && netem->flow_table.entries[tag].in_use) {
+                receive_target(netem, (uint32_t)tag, now_us);
+            }
+        }
+
+        output_flush(netem);
+
+        if (now_us >= next_sweep_us) {
+            sweep_flows(netem, now_us);
+            next_sweep_us = now_us + NETEM_SWEEP_US;
+        }
+    }
+    return 0;
+}
+
+void netem_free(Netem *netem) {
+    flow_table_free(&netem->flow_table);
+    if (netem->listen_fd >= 0) {
+        close(netem->listen_fd);
+    }
+    if (netem->epoll_fd >= 0) {
+        close(netem->epoll_fd);
+    }
+    for (int d = 0; d < 2; d++) {
+        send_batch_free(&netem->outputs[d].batch);
+        free(netem->outputs[d].packets);
+    }
+    recv_batch_free(&netem->batch);
+    free(netem->packets);
+    free(netem->packet_data);
+    free(netem->flows);
+    free(netem->due_flows);
+    memset(netem, 0, sizeof(*netem));
+}
+
+#else
+
+int netem_init(Netem *netem, const NetemConfig *config) {
+    (void)config;
+    memset(netem, 0, sizeof(*netem));
+    fprintf(stderr, "udp_netem requires Linux (epoll)\n");
+    return -1;
+}
+
+int netem_run(Netem *netem) {
+    (void)netem;
+    return -1;
+}
+
+void netem_free(Netem *netem) {
+    (void)netem;
+}
+
+#endif
+
+static void print_usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s -l listen_port -t target_ip:port [options]\n"
+            "  -L percent   datagram loss\n"
+            "  -B count     mean loss burst length (Gilbert-Elliott; default independent losses)\n"
+            "  -d ms        delay\n"
+            "  -j ms        jitter\n"
+            "  -D name      jitter distribution: uniform, normal or pareto (default uniform)\n"
+            "  -p percent   duplication\n"
+            "  -r percent   reordering: datagrams sent without the delay\n"
+            "  -R mbit      bandwidth cap per direction\n"
+            "  -q count     datagrams delayed per direction before tail drop (default %d)\n"
+            "  -m bytes     largest datagram (default %d)\n"
+            "  -b count     datagrams per recvmmsg/sendmmsg (default %d)\n"
+            "  -P count     datagrams held at once (default %d)\n"
+            "  -F count     client flows (default %d)\n"
+            "  -s seed      random seed\n",
+            program, NETEM_DEFAULT_QUEUE_LIMIT, NETEM_DEFAULT_MAX_SIZE, NETEM_DEFAULT_BATCH,
+            NETEM_DEFAULT_POOL, NETEM_DEFAULT_MAX_FLOWS);
+}
+
+int main(int argc, char *argv[]) {
+    NetemConfig config;
+    if (netem_parse_args(&config, argc, argv) < 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    Netem netem;
+    if (netem_init(&netem, &config) < 0) {
+        netem_free(&netem);
+        return 1;
+    }
+
+    // No SA_RESTART so epoll_wait returns and the loop sees the request
+    struct sigaction stop_action;
+    memset(&stop_action, 0, sizeof(stop_action));
+    stop_action.sa_handler = request_stop;
+    sigemptyset(&stop_action.sa_mask);
+    sigaction(SIGINT, &stop_action, NULL);
+    sigaction(SIGTERM, &stop_action, NULL);
+
+    const NetemParams *params = &config.params;
+    char target[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &config.target.sin_addr, target, sizeof(target));
+    printf("Relaying port %d to %s:%d: loss %.2f%% (burst %.1f), delay %.3f ms, jitter %.3f ms %s, "
+           "duplicate %.2f%%, reorder %.2f%%, rate %.1f Mbit/s, seed %llu\n",
+           config.listen_port, target, ntohs(config.target.sin_port), params->loss * 100.0,
+           params->loss_burst, params->delay_us / 1000.0, params->jitter_us / 1000.0,
+           distribution_names[params->distribution], params->duplicate * 100.0, params->reorder * 100.0,
+           params->rate_bps / 1e6, (unsigned long long)config.seed);
+    fflush(stdout);
+
+    int result = netem_run(&netem);
+    netem_print_stats(&netem, stdout);
+    netem_free(&netem);
+    return result < 0 ? 1 : 0;
+}
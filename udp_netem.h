@@ -0,0 +1,183 @@
+#ifndef UDP_NETEM_H
+#define UDP_NETEM_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <netinet/in.h>
+#include "batch_io.h"
+#include "timer_wheel.h"
+#include "flow_table.h"
+
+// Default emulator settings
+#define NETEM_DEFAULT_MAX_SIZE 2048         // bytes per datagram slot
+#define NETEM_DEFAULT_POOL 32768            // datagrams held at once
+#define NETEM_DEFAULT_BATCH 256             // datagrams per recvmmsg/sendmmsg call
+#define NETEM_DEFAULT_MAX_FLOWS 4096
+#define NETEM_DEFAULT_QUEUE_LIMIT 10000     // datagrams waiting per direction
+#define NETEM_FLOW_IDLE_US 60000000ULL      // flows unused this long are closed
+// Timer wheel tick; delays are rounded up to it
+#define NETEM_TICK_US 10
+
+// Directions of NetemDirection and NetemPacket
+#define NETEM_UPSTREAM 0        // client to target
+#define NETEM_DOWNSTREAM 1      // target to client
+
+/**
+ * Shape of the random part of the delay
+ */
+typedef enum {
+    NETEM_DIST_UNIFORM = 0,     // delay +/- jitter
+    NETEM_DIST_NORMAL,          // mean delay, standard deviation jitter
+    NETEM_DIST_PARETO           // delay plus a heavy tail with scale jitter
+} NetemDistribution;
+
+/**
+ * Impairments applied to each direction
+ */
+typedef struct {
+    double loss;                // probability a datagram is lost
+    double loss_burst;          // mean length of loss bursts (0 = independent losses)
+    double delay_us;
+    double jitter_us;
+    NetemDistribution distribution;
+    double duplicate;           // probability a datagram is sent twice
+    double reorder;             // probability a datagram skips the delay
+    double rate_bps;            // bandwidth cap in bits per second (0 = none)
+    uint32_t queue_limit;       // datagrams delayed per direction before tail drop
+} NetemParams;
+
+/**
+ * Emulator settings from the command line
+ */
+typedef struct {
+    int listen_port;
+    struct sockaddr_in target;
+    NetemParams params;
+    int max_size;
+    int pool_size;
+    int batch_size;
+    int max_flows;
+    uint64_t seed;
+} NetemConfig;
+
+/**
+ * Link state and counters of one direction
+ */
+typedef struct {
+    int bad_state;              // Gilbert-Elliott loss state
+    uint64_t link_free_us;      // when the rate-limited link finishes its backlog
+    uint32_t queued;
+    uint64_t received;
+    uint64_t forwarded;
+    uint64_t lost;
+    uint64_t duplicated;
+    uint64_t reordered;
+    uint64_t queue_drops;
+    uint64_t pool_drops;
+    uint64_t send_errors;
+} NetemDirection;
+
+/**
+ * Datagram held by the emulator. The timer node comes first so an
+ * expired TimerNode can be cast back to its packet.
+ */
+typedef struct NetemPacket {
+    TimerNode timer;
+    struct NetemPacket *next_free;
+    struct NetemPacket *next_due;   // next due packet of the same flow and direction
+    char *data;
+    uint32_t len;
+    uint32_t flow;
+    int direction;
+} NetemPacket;
+
+/**
+ * Emulator state of one client flow, indexed like the flow table entries.
+ * Datagrams from one client leave through the flow's own upstream socket.
+ */
+typedef struct {
+    uint32_t inflight;          // datagrams of this flow still held; the flow stays open
+    uint64_t last_active_us;
+    NetemPacket *due_head;      // upstream datagrams due to leave in this loop iteration
+    NetemPacket *due_tail;
+} NetemFlow;
+
+/**
+ * Outgoing datagrams of one direction and socket, sent with one sendmmsg call.
+ * The batch references packet memory, so packets are freed after the send.
+ */
+typedef struct {
+    SendBatch batch;
+    NetemPacket **packets;
+} NetemOutput;
+
+/**
+ * Emulator state
+ */
+typedef struct {
+    NetemConfig config;
+    int listen_fd;
+    int epoll_fd;
+    uint64_t origin_us;
+    uint64_t rng;
+
+    NetemDirection directions[2];
+    TimerWheel wheel;
+    NetemPacket *packets;
+    char *packet_data;
+    NetemPacket *free_list;
+
+    FlowTable flow_table;
+    NetemFlow *flows;
+    uint32_t last_flow;
+    uint32_t *due_flows;        // flows with upstream datagrams due, in order of the first one
+    uint32_t due_flow_count;
+    uint64_t flow_drops;
+
+    RecvBatch batch;
+    NetemOutput outputs[2];
+} Netem;
+
+/**
+ * Parse the command line
+ *
+ * @param config Parsed settings
+ * @param argc Argument count
+ * @param argv Arguments
+ * @return 0 on success, -1 on invalid arguments
+ */
+int netem_parse_args(NetemConfig *config, int argc, char *argv[]);
+
+/**
+ * Bind the listening socket and allocate the packet pool and flow table
+ *
+ * @param netem Emulator to initialize
+ * @param config Settings
+ * @return 0 on success, -1 on error
+ */
+int netem_init(Netem *netem, const NetemConfig *config);
+
+/**
+ * Relay and impair datagrams until SIGINT or SIGTERM
+ *
+ * @param netem Initialized emulator
+ * @return 0 after a signal, -1 on fatal error
+ */
+int netem_run(Netem *netem);
+
+/**
+ * Print the counters of both directions
+ *
+ * @param netem Emulator
+ * @param out Output stream
+ */
+void netem_print_stats(const Netem *netem, FILE *out);
+
+/**
+ * Close all sockets and release the emulator
+ *
+ * @param netem Emulator to free
+ */
+void netem_free(Netem *netem);
+
+#endif /* UDP_NETEM_H */
@@ -9,38 +9,28 @@
 #include <jansson.h>
 #include <time.h>
 #include <errno.h>
+#include <poll.h>
+#include <signal.h>
 #include <netinet/ip.h>
-
-// Default configuration
-#define DEFAULT_PORT 8888
-#define DEFAULT_BUFFER_SIZE 1024
-#define DEFAULT_RESPONSE "Message received"
-#define DEFAULT_LOG_FILE "udp_server.log"
-
-// Default socket options
-#define DEFAULT_REUSE_ADDR 1
-#define DEFAULT_RCVBUF_SIZE 8192
-#define DEFAULT_SNDBUF_SIZE 8192
-#define DEFAULT_BROADCAST 0
-#define DEFAULT_TTL 64
-#define DEFAULT_RCVTIMEO 0
-
-// Server configuration structure
-typedef struct {
-    int port;
-    int buffer_size;
-    char response_message[256];
-    char log_file[256];
-    int logging_enabled;
-
-    // Socket options
-    int reuse_addr;
-    int receive_buffer;
-    int send_buffer;
-    int broadcast;
-    int ttl;
-    int receive_timeout;
-} ServerConfig;
+#include "udp_server.h"
+#include "config.h"
+#include "batch_io.h"
+#include "overload.h"
+#include "metrics.h"
+#include "handler.h"
+#include "pending.h"
+#include "proxy.h"
+#include "echo.h"
+#include "filter.h"
+#include "auth.h"
+#include "trace.h"
+
+// Poll timeout for the receive loop; bounds the latency of periodic work
+#define SERVER_TICK_MS 50
+// Poll timeout while deferred requests are in flight; bounds timeout accuracy
+#define PENDING_TICK_MS 5
+// Smallest per-reply buffer handed to handlers
+#define MIN_RESPONSE_BUFFER_SIZE 512
 
 // Function to write JSON logs
 void write_json_log(FILE *log_fp, const char *event_type, const char *message,
@@ -67,7 +57,9 @@ void write_json_log(FILE *log_fp, const char *event_type, const char *message,
     // Dump JSON
     char *json_str = json_dumps(log_entry, JSON_INDENT(2));
     fprintf(log_fp, "%s\n", json_str);
+    TRACE_BEGIN(flush_start);
     fflush(log_fp);
+    TRACE_END(TRACE_LOG_FLUSH, flush_start);
 
     // Cleanup
     free(json_str);
@@ -161,152 +153,651 @@ int apply_socket_options(int sockfd, const ServerConfig *config, FILE *log_fp) {
         printf("Set SO_RCVTIMEO: %d seconds\n", config->receive_timeout);
     }
 
+    // Overload protection reads the kernel drop counter and arrival time of each datagram
+    if (config->overload_enabled) {
+#ifdef SO_RXQ_OVFL
+        int optval = 1;
+        result = setsockopt(sockfd, SOL_SOCKET, SO_RXQ_OVFL, &optval, sizeof(optval));
+        if (result < 0) {
+            perror("Failed to set SO_RXQ_OVFL");
+            if (log_fp) {
+                write_json_log(log_fp, "socket_error", "Failed to enable drop counter", NULL, 0);
+            }
+            return -1;
+        }
+        printf("Set SO_RXQ_OVFL: enabled\n");
+#endif
+    }
+
+    // Echo mode timestamps replies with the same kernel arrival time
+    int echo_timestamps = strcmp(config->mode, "echo") == 0 && strcmp(config->echo_stamp, "timestamp") == 0;
+    if (config->overload_enabled || echo_timestamps) {
+#ifdef SO_TIMESTAMPNS
+        int optval = 1;
+        result = setsockopt(sockfd, SOL_SOCKET, SO_TIMESTAMPNS, &optval, sizeof(optval));
+        if (result < 0) {
+            perror("Failed to set SO_TIMESTAMPNS");
+            if (log_fp) {
+                write_json_log(log_fp, "socket_error", "Failed to enable receive timestamps", NULL, 0);
+            }
+            return -1;
+        }
+        printf("Set SO_TIMESTAMPNS: enabled\n");
+#endif
+    }
+
     return 0;
 }
 
-// Function to load configuration from YAML file
-ServerConfig load_config(const char *config_file) {
-    ServerConfig config;
-    // Set default values
-    config.port = DEFAULT_PORT;
-    config.buffer_size = DEFAULT_BUFFER_SIZE;
-    strcpy(config.response_message, DEFAULT_RESPONSE);
-    strcpy(config.log_file, DEFAULT_LOG_FILE);
-    config.logging_enabled = 1;
-
-    // Set default socket options
-    config.reuse_addr = DEFAULT_REUSE_ADDR;
-    config.receive_buffer = DEFAULT_RCVBUF_SIZE;
-    config.send_buffer = DEFAULT_SNDBUF_SIZE;
-    config.broadcast = DEFAULT_BROADCAST;
-    config.ttl = DEFAULT_TTL;
-    config.receive_timeout = DEFAULT_RCVTIMEO;
-
-    FILE *fh = fopen(config_file, "r");
-    if (!fh) {
-        fprintf(stderr, "Cannot open configuration file %s. Using default settings.\n", config_file);
-        return config;
-    }
-
-    yaml_parser_t parser;
-    yaml_event_t event;
-
-    // Initialize parser
-    if (!yaml_parser_initialize(&parser)) {
-        fprintf(stderr, "Failed to initialize YAML parser.\n");
-        fclose(fh);
-        return config;
-    }
-
-    yaml_parser_set_input_file(&parser, fh);
-
-    char key[256] = {0};
-    int in_server_section = 0;
-    int in_logging_section = 0;
-    int in_socket_options_section = 0;
-    int done = 0;
-
-    while (!done) {
-        if (!yaml_parser_parse(&parser, &event)) {
-            fprintf(stderr, "Parse error\n");
-            break;
-        }
-
-        switch(event.type) {
-            case YAML_SCALAR_EVENT:
-                if (strcmp((char *)event.data.scalar.value, "server") == 0) {
-                    in_server_section = 1;
-                    in_logging_section = 0;
-                    in_socket_options_section = 0;
-                } else if (strcmp((char *)event.data.scalar.value, "logging") == 0) {
-                    in_server_section = 0;
-                    in_logging_section = 1;
-                    in_socket_options_section = 0;
-                } else if (strcmp((char *)event.data.scalar.value, "socket_options") == 0) {
-                    in_server_section = 0;
-                    in_logging_section = 0;
-                    in_socket_options_section = 1;
-                } else if (in_server_section && strcmp(key, "") == 0) {
-                    strcpy(key, (char *)event.data.scalar.value);
-                } else if (in_server_section && strcmp(key, "port") == 0) {
-                    config.port = atoi((char *)event.data.scalar.value);
-                    key[0] = '\0';
-                } else if (in_server_section && strcmp(key, "buffer_size") == 0) {
-                    config.buffer_size = atoi((char *)event.data.scalar.value);
-                    key[0] = '\0';
-                } else if (in_server_section && strcmp(key, "response_message") == 0) {
-                    strcpy(config.response_message, (char *)event.data.scalar.value);
-                    key[0] = '\0';
-                } else if (in_logging_section && strcmp(key, "") == 0) {
-                    strcpy(key, (char *)event.data.scalar.value);
-                } else if (in_logging_section && strcmp(key, "file") == 0) {
-                    strcpy(config.log_file, (char *)event.data.scalar.value);
-                    key[0] = '\0';
-                } else if (in_logging_section && strcmp(key, "enable") == 0) {
-                    config.logging_enabled = strcmp((char *)event.data.scalar.value, "true") == 0 ? 1 : 0;
-                    key[0] = '\0';
-                } else if (in_socket_options_section && strcmp(key, "") == 0) {
-                    strcpy(key, (char *)event.data.scalar.value);
-                } else if (in_socket_options_section && strcmp(key, "reuse_addr") == 0) {
-                    config.reuse_addr = strcmp((char *)event.data.scalar.value, "true") == 0 ? 1 : 0;
-                    key[0] = '\0';
-                } else if (in_socket_options_section && strcmp(key, "receive_buffer") == 0) {
-                    config.receive_buffer = atoi((char *)event.data.scalar.value);
-                    key[0] = '\0';
-                } else if (in_socket_options_section && strcmp(key, "send_buffer") == 0) {
-                    config.send_buffer = atoi((char *)event.data.scalar.value);
-                    key[0] = '\0';
-                } else if (in_socket_options_section && strcmp(key, "broadcast") == 0) {
-                    config.broadcast = strcmp((char *)event.data.scalar.value, "true") == 0 ? 1 : 0;
-                    key[0] = '\0';
-                } else if (in_socket_options_section && strcmp(key, "ttl") == 0) {
-                    config.ttl = atoi((char *)event.data.scalar.value);
-                    key[0] = '\0';
-                } else if (in_socket_options_section && strcmp(key, "receive_timeout") == 0) {
-                    config.receive_timeout = atoi((char *)event.data.scalar.value);
-                    key[0] = '\0';
-                }
-                break;
-            case YAML_MAPPING_END_EVENT:
-                if (in_server_section) {
-                    in_server_section = 0;
-                } else if (in_logging_section) {
-                    in_logging_section = 0;
-                } else if (in_socket_options_section) {
-                    in_socket_options_section = 0;
+// Runtime state of the receive loop
+typedef struct {
+    int server_fd;
+    const ServerConfig *config;
+    const char *config_file;
+    FILE *log_fp;
+    RecvBatch batch;
+    SendBatch replies;
+    OverloadController overload;
+    Filter filter;
+    AuthVerifier auth;
+    ServerMetrics metrics;
+    const RequestHandler *handler;
+    void *handler_state;
+    PendingTable pending;
+    char *scratch;
+    size_t scratch_size;
+} ServerContext;
+
+// Set by SIGHUP; the receive loop reloads the authentication keys
+static volatile sig_atomic_t reload_requested = 0;
+// Set by SIGUSR1; the receive loop writes the trace file
+static volatile sig_atomic_t trace_dump_requested = 0;
+
+static void request_reload(int sig) {
+    (void)sig;
+    reload_requested = 1;
+}
+
+static void request_trace_dump(int sig) {
+    (void)sig;
+    trace_dump_requested = 1;
+}
+
+// Function to get a monotonic timestamp in milliseconds
+uint64_t monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+// Function to send queued replies and log them
+static void flush_replies(ServerContext *ctx) {
+    unsigned int count = ctx->replies.count;
+    if (count == 0) {
+        return;
+    }
+
+    // A rejected datagram is skipped and the rest still go out, so only the replies
+    // sendmmsg wrote a length back for were sent
+    for (unsigned int i = 0; i < count; i++) {
+        ctx->replies.msgs[i].msg_len = 0;
+    }
+
+    TRACE_BEGIN(send_start);
+    int sent = send_batch_flush(ctx->server_fd, &ctx->replies);
+    TRACE_END(TRACE_SEND, send_start);
+    ctx->metrics.packets_sent += sent;
+    ctx->metrics.send_errors += count - sent;
+    for (unsigned int i = 0; i < count; i++) {
+        ctx->metrics.bytes_sent += ctx->replies.msgs[i].msg_len;
+    }
+
+    if (ctx->log_fp && ctx->overload.level < OVERLOAD_NO_PAYLOAD_LOG && !ctx->handler->quiet) {
+        TRACE_BEGIN(log_start);
+        for (unsigned int i = 0; i < count; i++) {
+            if (ctx->replies.msgs[i].msg_len == 0) {
+                continue;
+            }
+            const struct sockaddr_in *client_addr = &ctx->replies.addrs[i];
+            char client_ip[INET_ADDRSTRLEN];
+            char message[DEFAULT_BUFFER_SIZE + 1];
+            size_t len = ctx->replies.iovecs[i].iov_len;
+            if (len > DEFAULT_BUFFER_SIZE) {
+                len = DEFAULT_BUFFER_SIZE;
+            }
+            memcpy(message, ctx->replies.iovecs[i].iov_base, len);
+            message[len] = '\0';
+
+            inet_ntop(AF_INET, &(client_addr->sin_addr), client_ip, INET_ADDRSTRLEN);
+            write_json_log(ctx->log_fp, "message_sent", message, client_ip, ntohs(client_addr->sin_port));
+        }
+        TRACE_END(TRACE_LOG, log_start);
+    }
+}
+
+// Function to queue a reply by copy, flushing first when the batch is full
+static void queue_reply(void *arg, const struct sockaddr_in *client, const char *response, size_t len) {
+    ServerContext *ctx = arg;
+    if (ctx->replies.count >= ctx->replies.size) {
+        flush_replies(ctx);
+    }
+    send_batch_add(&ctx->replies, client, response, len);
+}
+
+// Function to collect overload signals from the ancillary data of a batch
+static void observe_batch(ServerContext *ctx, int count) {
+    uint32_t drop_counter = 0;
+    int have_drop_counter = 0;
+    double max_delay_us = 0.0;
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    for (int i = 0; i < count; i++) {
+        uint32_t drops;
+        struct timespec arrival;
+        if (recv_batch_drops(&ctx->batch, i, &drops) && (!have_drop_counter || drops > drop_counter)) {
+            drop_counter = drops;
+            have_drop_counter = 1;
+        }
+        if (recv_batch_timestamp(&ctx->batch, i, &arrival)) {
+            double delay_us = (double)(now.tv_sec - arrival.tv_sec) * 1e6 +
+                              (double)(now.tv_nsec - arrival.tv_nsec) / 1e3;
+            if (delay_us > max_delay_us) {
+                max_delay_us = delay_us;
+            }
+        }
+    }
+
+    overload_observe_batch(&ctx->overload, count, ctx->batch.size,
+                           drop_counter, have_drop_counter, max_delay_us);
+}
+
+// Function to apply the actions of matched filter rules; returns 1 if the datagram was consumed
+static int apply_filter(ServerContext *ctx, uint64_t matched, const char *buffer, size_t len,
+                        const struct sockaddr_in *client_addr) {
+    Filter *filter = &ctx->filter;
+    for (uint64_t rules = matched; rules; rules &= rules - 1) {
+        filter->rules[__builtin_ctzll(rules)].hits++;
+    }
+
+    if (matched & filter->drop_rules || (matched & filter->route_rules && !filter->have_route)) {
+        ctx->metrics.filter_dropped++;
+        return 1;
+    }
+
+    if (matched & filter->route_rules) {
+        if (ctx->replies.count >= ctx->replies.size) {
+            flush_replies(ctx);
+        }
+        send_batch_add_ref(&ctx->replies, &filter->route_addr, buffer, len);
+        ctx->metrics.filter_routed++;
+        return 1;
+    }
+
+    ctx->metrics.filter_tagged++;
+    if (ctx->log_fp && ctx->overload.level < OVERLOAD_NO_PAYLOAD_LOG && !ctx->handler->quiet) {
+        char client_ip[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &(client_addr->sin_addr), client_ip, INET_ADDRSTRLEN);
+        const FilterRule *rule = &filter->rules[__builtin_ctzll(matched & filter->tag_rules)];
+        write_json_log(ctx->log_fp, "filter_tag", rule->pattern, client_ip, ntohs(client_addr->sin_port));
+    }
+    return 0;
+}
+
+// Function to run the request handler over one received batch
+static void handle_batch(ServerContext *ctx, int count) {
+    const ServerConfig *config = ctx->config;
+    OverloadLevel level = ctx->overload.level;
+
+    ctx->metrics.batches++;
+    observe_batch(ctx, count);
+    if (ctx->auth.enabled) {
+        TRACE_BEGIN(auth_start);
+        auth_verify_batch(&ctx->auth, &ctx->batch, count);
+        TRACE_END(TRACE_AUTH, auth_start);
+    }
+
+    for (int i = 0; i < count; i++) {
+        char *buffer = recv_batch_payload(&ctx->batch, i);
+        unsigned int len = ctx->batch.msgs[i].msg_len;
+        struct sockaddr_in *client_addr = &ctx->batch.addrs[i];
+
+        ctx->metrics.packets_received++;
+        ctx->metrics.bytes_received += len;
+
+        // Unauthenticated datagrams are dropped before filtering and logging;
+        // authenticated ones continue with the framing stripped
+        if (ctx->auth.enabled) {
+            AuthResult auth = ctx->auth.results[i];
+            if (auth == AUTH_MALFORMED) {
+                ctx->metrics.auth_malformed++;
+                continue;
+            } else if (auth == AUTH_UNKNOWN_KEY) {
+                ctx->metrics.auth_unknown_key++;
+                continue;
+            } else if (auth == AUTH_BAD_TAG) {
+                ctx->metrics.auth_bad_tag++;
+                continue;
+            }
+            ctx->metrics.auth_verified++;
+            buffer += AUTH_KEY_ID_SIZE;
+            len -= AUTH_OVERHEAD;
+            buffer[len] = '\0';
+        }
+
+        // Blocked payloads are discarded before any other processing or logging
+        if (ctx->filter.rule_count > 0) {
+            TRACE_BEGIN(filter_start);
+            uint64_t matched = filter_match(&ctx->filter, buffer, len);
+            TRACE_END(TRACE_FILTER, filter_start);
+            if (matched && apply_filter(ctx, matched, buffer, len, client_addr)) {
+                continue;
+            }
+        }
+
+        if (level >= OVERLOAD_SHED &&
+            overload_is_low_priority(&ctx->overload, client_addr, buffer, len)) {
+            ctx->metrics.shed_packets++;
+            continue;
+        }
+
+        if (level < OVERLOAD_NO_PAYLOAD_LOG && !ctx->handler->quiet) {
+            TRACE_BEGIN(log_start);
+            char client_ip[INET_ADDRSTRLEN];
+            inet_ntop(AF_INET, &(client_addr->sin_addr), client_ip, INET_ADDRSTRLEN);
+            int client_port = ntohs(client_addr->sin_port);
+
+            printf("Message from client %s:%d: %s\n",
+                   client_ip, client_port, buffer);
+
+            if (ctx->log_fp) {
+                write_json_log(ctx->log_fp, "message_received", buffer, client_ip, client_port);
+            }
+            TRACE_END(TRACE_LOG, log_start);
+        }
+
+        if (ctx->replies.count >= ctx->replies.size) {
+            flush_replies(ctx);
+        }
+
+        // Under pressure answer with the busy message instead of running the handler
+        if (level >= OVERLOAD_BUSY_REPLY) {
+            ctx->metrics.busy_replies++;
+            send_batch_add_ref(&ctx->replies, client_addr, config->busy_message,
+                               strlen(config->busy_message));
+            continue;
+        }
+
+        HandlerCall call;
+        memset(&call, 0, sizeof(call));
+        call.payload = buffer;
+        call.len = len;
+        call.client = client_addr;
+        call.response_buffer = send_batch_next_buffer(&ctx->replies);
+        call.response_buffer_size = ctx->replies.buffer_size;
+        call.pending = &ctx->pending;
+        call.timeout_ms = config->async_timeout_ms;
+        call.sockfd = ctx->server_fd;
+
+        TRACE_BEGIN(handler_start);
+        HandlerResult result = ctx->handler->handle(ctx->handler_state, &call);
+        TRACE_END(TRACE_HANDLER, handler_start);
+        if (result == HANDLER_DONE && call.response_len > 0) {
+            send_batch_add_ref(&ctx->replies, client_addr, call.response, call.response_len);
+        }
+    }
+}
+
+// Function to run periodic work: overload evaluation and metrics snapshots
+static void handle_tick(ServerContext *ctx, uint64_t now_ms, uint64_t *next_metrics_ms) {
+    if (overload_evaluate(&ctx->overload, now_ms)) {
+        char message[128];
+        snprintf(message, sizeof(message), "Overload level changed to %s (pressure %.2f)",
+                 overload_level_name(ctx->overload.level), ctx->overload.pressure);
+        printf("%s\n", message);
+        if (ctx->log_fp) {
+            write_json_log(ctx->log_fp, "overload_level", message, NULL, 0);
+        }
+    }
+
+    if (ctx->config->metrics_interval > 0 && now_ms >= *next_metrics_ms) {
+        ServerMetrics *metrics = &ctx->metrics;
+        if (ctx->overload.have_drop_counter) {
+            metrics->kernel_drops = ctx->overload.last_drop_counter;
+        }
+        metrics->overload_level = ctx->overload.level;
+        metrics->overload_level_name = overload_level_name(ctx->overload.level);
+        metrics->overload_transitions = ctx->overload.transitions;
+        metrics->overload_pressure = ctx->overload.pressure;
+        metrics->queue_delay_us = ctx->overload.last_delay_us;
+        metrics->batch_fill = ctx->overload.last_fill;
+
+        metrics->pending_in_flight = ctx->pending.in_flight;
+        metrics->pending_started = ctx->pending.started;
+        metrics->pending_completed = ctx->pending.completed;
+        metrics->pending_timed_out = ctx->pending.timed_out;
+        metrics->pending_rejected = ctx->pending.rejected;
+        metrics->pending_stale = ctx->pending.stale;
+
+        if (ctx->filter.rule_count > 0) {
+            metrics->filter_enabled = 1;
+            metrics->filter_impl = filter_impl_name(ctx->filter.impl);
+            metrics->filter_rule_count = ctx->filter.rule_count;
+            for (int i = 0; i < ctx->filter.rule_count; i++) {
+                const FilterRule *rule = &ctx->filter.rules[i];
+                snprintf(metrics->filter_rules[i].rule, sizeof(metrics->filter_rules[i].rule), "%s:%s",
+                         rule->action == FILTER_DROP ? "drop" : rule->action == FILTER_ROUTE ? "route" : "tag",
+                         rule->pattern);
+                metrics->filter_rules[i].hits = rule->hits;
+            }
+        }
+
+        if (ctx->auth.enabled) {
+            metrics->auth_enabled = 1;
+            metrics->auth_impl = siphash_x4_impl();
+            metrics->auth_keys = ctx->auth.key_count;
+        }
+
+        if (trace_enabled) {
+            TraceStageStats stats[TRACE_STAGE_COUNT];
+            trace_stage_stats(stats);
+            metrics->trace_enabled = 1;
+            metrics->trace_sample_every = ctx->config->trace_sample_every;
+            for (int i = 0; i < TRACE_STAGE_COUNT; i++) {
+                TraceStageMetrics *stage = &metrics->trace_stages[i];
+                stage->name = trace_stage_name((TraceStage)i);
+                stage->spans = stats[i].count;
+                stage->total_ms = trace_ticks_to_ns(stats[i].cycles) / 1e6;
+                stage->avg_ns = stats[i].count ? trace_ticks_to_ns(stats[i].cycles) / (double)stats[i].count : 0.0;
+                stage->max_ns = trace_ticks_to_ns(stats[i].max_cycles);
+            }
+        }
+
+        if (ctx->handler->report) {
+            ctx->handler->report(ctx->handler_state, metrics);
+        }
+
+        TRACE_BEGIN(metrics_start);
+        if (write_metrics(metrics, ctx->config->metrics_file) < 0 && ctx->log_fp) {
+            write_json_log(ctx->log_fp, "error", "Failed to write metrics", NULL, 0);
+        }
+        TRACE_END(TRACE_METRICS, metrics_start);
+        *next_metrics_ms = now_ms + (uint64_t)ctx->config->metrics_interval * 1000;
+    }
+}
+
+// Function to reload the authentication keys from the configuration file
+static void reload_auth(ServerContext *ctx) {
+    ServerConfig *fresh = malloc(sizeof(ServerConfig));
+    AuthVerifier *staged = malloc(sizeof(AuthVerifier));
+    if (!fresh || !staged) {
+        perror("Memory allocation failed");
+        free(fresh);
+        free(staged);
+        return;
+    }
+
+    // A missing or half-parsed file would load defaults and could silently turn authentication
+    // off, and a table without valid keys would drop every datagram; keep the current keys then
+    const char *rejected = NULL;
+    int result = 0;
+    if (read_config(ctx->config_file, fresh) < 0) {
+        rejected = "configuration file could not be read";
+    } else {
+        *staged = ctx->auth;
+        result = auth_load_keys(staged, fresh);
+        if (staged->enabled && staged->key_count == 0) {
+            rejected = "authentication enabled without valid keys";
+        } else {
+            ctx->auth = *staged;
+            ctx->metrics.auth_reloads++;
+        }
+    }
+    free(fresh);
+    free(staged);
+
+    if (rejected) {
+        char message[160];
+        snprintf(message, sizeof(message), "Authentication reload rejected: %s; keeping %d keys",
+                 rejected, ctx->auth.key_count);
+        fprintf(stderr, "%s\n", message);
+        if (ctx->log_fp) {
+            write_json_log(ctx->log_fp, "error", message, NULL, 0);
+        }
+        return;
+    }
+
+    char message[128];
+    snprintf(message, sizeof(message), "Authentication reloaded: %s, %d keys",
+             ctx->auth.enabled ? "enabled" : "disabled", ctx->auth.key_count);
+    printf("%s\n", message);
+    if (ctx->log_fp) {
+        if (result < 0) {
+            write_json_log(ctx->log_fp, "warning", "Ignored invalid authentication keys", NULL, 0);
+        }
+        write_json_log(ctx->log_fp, "auth_reload", message, NULL, 0);
+    }
+}
+
+// Function to write the trace file and the per-stage cost table
+static void dump_trace(ServerContext *ctx) {
+    const char *path = ctx->config->trace_output_file;
+    int spans = trace_dump(path, stdout);
+    char message[320];
+    if (spans < 0) {
+        snprintf(message, sizeof(message), "Failed to write trace file %s", path);
+    } else {
+        snprintf(message, sizeof(message), "Wrote %d spans to %s", spans, path);
+    }
+    printf("%s\n", message);
+    if (ctx->log_fp) {
+        write_json_log(ctx->log_fp, spans < 0 ? "error" : "trace_dump", message, NULL, 0);
+    }
+}
+
+// Function to run the request/response server loop on a bound socket
+static int run_server(int server_fd, const ServerConfig *config, const char *config_file, FILE *log_fp) {
+    ServerContext ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.server_fd = server_fd;
+    ctx.config = config;
+    ctx.config_file = config_file;
+    trace_thread_start("receive loop");
+    ctx.log_fp = log_fp;
+
+    ctx.handler = find_handler(config->handler);
+    if (!ctx.handler) {
+        fprintf(stderr, "Unknown handler %s. Using %s.\n", config->handler, DEFAULT_HANDLER);
+        ctx.handler = find_handler(DEFAULT_HANDLER);
+    }
+
+    ctx.scratch_size = config->buffer_size > MIN_RESPONSE_BUFFER_SIZE ? config->buffer_size : MIN_RESPONSE_BUFFER_SIZE;
+    ctx.scratch = malloc(ctx.scratch_size);
+    if (!ctx.scratch ||
+        recv_batch_init(&ctx.batch, config->batch_size, config->buffer_size) < 0 ||
+        send_batch_init(&ctx.replies, config->batch_size, ctx.scratch_size) < 0 ||
+        pending_table_init(&ctx.pending, config->max_pending, monotonic_ms()) < 0) {
+        perror("Memory allocation failed");
+        if (log_fp) {
+            write_json_log(log_fp, "error", "Memory allocation failed", NULL, 0);
+        }
+        return -1;
+    }
+
+    if (ctx.handler->init && ctx.handler->init(config, &ctx.handler_state) < 0) {
+        fprintf(stderr, "Failed to initialize handler %s\n", ctx.handler->name);
+        if (log_fp) {
+            write_json_log(log_fp, "error", "Handler initialization failed", NULL, 0);
+        }
+        return -1;
+    }
+
+    if (filter_init(&ctx.filter, config) < 0 && log_fp) {
+        write_json_log(log_fp, "warning", "Ignored invalid filter rules", NULL, 0);
+    }
+    if (ctx.filter.rule_count > 0) {
+        printf("Payload filter: %d rules, %s matcher\n", ctx.filter.rule_count,
+               filter_impl_name(ctx.filter.impl));
+    }
+
+    int auth_result = auth_init(&ctx.auth, config);
+    if (!ctx.auth.results) {
+        perror("Memory allocation failed");
+        return -1;
+    }
+    if (auth_result < 0 && log_fp) {
+        write_json_log(log_fp, "warning", "Ignored invalid authentication keys", NULL, 0);
+    }
+    if (ctx.auth.enabled) {
+        printf("Authentication: %d keys, %s verifier\n", ctx.auth.key_count, siphash_x4_impl());
+    }
+
+    // SIGHUP reloads the authentication keys; no SA_RESTART so poll() wakes up
+    struct sigaction reload_action;
+    memset(&reload_action, 0, sizeof(reload_action));
+    reload_action.sa_handler = request_reload;
+    sigemptyset(&reload_action.sa_mask);
+    sigaction(SIGHUP, &reload_action, NULL);
+
+    // SIGUSR1 writes the trace file
+    if (trace_enabled) {
+        struct sigaction dump_action;
+        memset(&dump_action, 0, sizeof(dump_action));
+        dump_action.sa_handler = request_trace_dump;
+        sigemptyset(&dump_action.sa_mask);
+        sigaction(SIGUSR1, &dump_action, NULL);
+        printf("Tracing: one of %d loop iterations sampled, SIGUSR1 writes %s\n",
+               config->trace_sample_every, config->trace_output_file);
+    }
+
+    uint64_t now_ms = monotonic_ms();
+    if (overload_init(&ctx.overload, config, now_ms) < 0 && log_fp) {
+        write_json_log(log_fp, "warning", "Ignored invalid low priority rules", NULL, 0);
+    }
+
+    printf("UDP server started. Listening on port %d...\n", config->port);
+
+    struct pollfd pfds[2] = {
+        { .fd = ctx.server_fd, .events = POLLIN },
+        { .fd = pending_wake_fd(&ctx.pending), .events = POLLIN }
+    };
+    uint64_t last_activity_ms = now_ms;
+    uint64_t next_metrics_ms = now_ms;
+
+    while (1) {
+        // Wake up often enough to honour deferred request timeouts
+        int timeout_ms = ctx.pending.in_flight > 0 ? PENDING_TICK_MS : SERVER_TICK_MS;
+        int ready = poll(pfds, 2, timeout_ms);
+        now_ms = monotonic_ms();
+        TRACE_SAMPLE();
+
+        if (ready < 0 && errno != EINTR) {
+            perror("Poll error");
+        }
+
+        if (reload_requested) {
+            reload_requested = 0;
+            reload_auth(&ctx);
+        }
+        if (trace_dump_requested) {
+            trace_dump_requested = 0;
+            dump_trace(&ctx);
+        }
+
+        TRACE_BEGIN(pending_start);
+        pending_expire(&ctx.pending, now_ms, config->fallback_message,
+                       ctx.scratch, ctx.scratch_size, queue_reply, &ctx);
+
+        if (ready > 0 && (pfds[1].revents & POLLIN)) {
+            pending_drain(&ctx.pending, ctx.scratch, ctx.scratch_size, queue_reply, &ctx);
+        }
+        TRACE_END(TRACE_PENDING, pending_start);
+
+        if (ready > 0 && (pfds[0].revents & POLLIN)) {
+            // Drain up to one batch per wakeup so periodic work still runs under load
+            TRACE_BEGIN(recv_start);
+            int count = recv_batch(ctx.server_fd, &ctx.batch);
+            TRACE_END(TRACE_RECV, recv_start);
+            if (count < 0) {
+                perror("Receive error");
+                ctx.metrics.receive_errors++;
+                if (log_fp) {
+                    write_json_log(log_fp, "error", "Failed to receive message", NULL, 0);
                 }
-                break;
-            case YAML_STREAM_END_EVENT:
-                done = 1;
-                break;
-            default:
-                break;
+            } else if (count > 0) {
+                handle_batch(&ctx, count);
+                last_activity_ms = now_ms;
+            }
+        } else if (ready == 0 && config->receive_timeout > 0 &&
+                   now_ms - last_activity_ms >= (uint64_t)config->receive_timeout * 1000) {
+            // This is a timeout case - we can handle it if needed
+            printf("Receive timeout occurred\n");
+            if (log_fp) {
+                write_json_log(log_fp, "timeout", "Receive timeout occurred", NULL, 0);
+            }
+            last_activity_ms = now_ms;
         }
 
-        yaml_event_delete(&event);
+        flush_replies(&ctx);
+        TRACE_BEGIN(tick_start);
+        if (ctx.handler->tick) {
+            ctx.handler->tick(ctx.handler_state, now_ms);
+        }
+        TRACE_END(TRACE_TICK, tick_start);
+        handle_tick(&ctx, now_ms, &next_metrics_ms);
     }
 
-    yaml_parser_delete(&parser);
-    fclose(fh);
+    if (ctx.handler->destroy) {
+        ctx.handler->destroy(ctx.handler_state);
+    }
+    auth_free(&ctx.auth);
+    pending_table_free(&ctx.pending);
+    recv_batch_free(&ctx.batch);
+    send_batch_free(&ctx.replies);
+    free(ctx.scratch);
+    return 0;
+}
 
-    printf("Configuration loaded: Port=%d, Buffer size=%d, Response message=%s\n",
-           config.port, config.buffer_size, config.response_message);
-    printf("Log settings: File=%s, Enabled=%s\n",
-           config.log_file, config.logging_enabled ? "yes" : "no");
-    printf("Socket options: REUSEADDR=%s, RCVBUF=%d, SNDBUF=%d, BROADCAST=%s, TTL=%d, RCVTIMEO=%d\n",
-           config.reuse_addr ? "yes" : "no",
-           config.receive_buffer,
-           config.send_buffer,
-           config.broadcast ? "yes" : "no",
-           config.ttl,
-           config.receive_timeout);
+// Function to run proxy mode on a bound socket
+static int run_proxy(int server_fd, const ServerConfig *config, FILE *log_fp) {
+    Proxy proxy;
+    int result = proxy_init(&proxy, config, server_fd, log_fp);
+    if (result == 0) {
+        printf("UDP proxy started. Listening on port %d...\n", config->port);
+        result = proxy_run(&proxy);
+    } else if (log_fp) {
+        write_json_log(log_fp, "error", "Proxy initialization failed", NULL, 0);
+    }
+    proxy_free(&proxy);
+    return result;
+}
 
-    return config;
+// Function to run echo mode on a bound socket
+static int run_echo(int server_fd, const ServerConfig *config, FILE *log_fp) {
+    EchoServer echo;
+    int result = echo_init(&echo, config, server_fd, log_fp);
+    if (result == 0) {
+        printf("UDP echo server started. Listening on port %d...\n", config->port);
+        result = echo_run(&echo);
+    } else if (log_fp) {
+        write_json_log(log_fp, "error", "Echo initialization failed", NULL, 0);
+    }
+    echo_free(&echo);
+    return result;
 }
 
-int main() {
+int main(int argc, char *argv[]) {
     // Load configuration from file
-    ServerConfig config = load_config("config.yaml");
+    const char *config_file = argc > 1 ? argv[1] : DEFAULT_CONFIG_FILE;
+    ServerConfig config = load_config(config_file);
+    trace_init(&config);
+
+    // A stray trace dump request must not terminate a mode without the dump handler
+    struct sigaction ignore_action;
+    memset(&ignore_action, 0, sizeof(ignore_action));
+    ignore_action.sa_handler = SIG_IGN;
+    sigemptyset(&ignore_action.sa_mask);
+    sigaction(SIGUSR1, &ignore_action, NULL);
 
     // Open log file
     FILE *log_fp = NULL;
@@ -320,23 +811,11 @@ int main() {
     }
 
     int server_fd;
-    struct sockaddr_in server_addr, client_addr;
-    char *buffer = malloc(config.buffer_size);
-    if (!buffer) {
-        perror("Memory allocation failed");
-        if (log_fp) {
-            write_json_log(log_fp, "error", "Memory allocation failed", NULL, 0);
-            fclose(log_fp);
-        }
-        exit(EXIT_FAILURE);
-    }
-
-    socklen_t client_len = sizeof(client_addr);
+    struct sockaddr_in server_addr;
 
     // Create socket
     if ((server_fd = socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
         perror("Socket creation failed");
-        free(buffer);
         if (log_fp) {
             write_json_log(log_fp, "error", "Socket creation failed", NULL, 0);
             fclose(log_fp);
@@ -353,7 +832,6 @@ int main() {
     }
 
     memset(&server_addr, 0, sizeof(server_addr));
-    memset(&client_addr, 0, sizeof(client_addr));
 
     // Configure server address
     server_addr.sin_family = AF_INET;
@@ -364,7 +842,6 @@ int main() {
     if (bind(server_fd, (const struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
         perror("Bind failed");
         close(server_fd);
-        free(buffer);
         if (log_fp) {
             write_json_log(log_fp, "error", "Socket bind failed", NULL, 0);
             fclose(log_fp);
@@ -372,56 +849,19 @@ int main() {
         exit(EXIT_FAILURE);
     }
 
-    printf("UDP server started. Listening on port %d...\n", config.port);
-
-    while (1) {
-        // Receive message from client
-        int len = recvfrom(server_fd, buffer, config.buffer_size, 0,
-                         (struct sockaddr *)&client_addr, &client_len);
-
-        if (len < 0) {
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                // This is a timeout case - we can handle it if needed
-                printf("Receive timeout occurred\n");
-                if (log_fp) {
-                    write_json_log(log_fp, "timeout", "Receive timeout occurred", NULL, 0);
-                }
-                continue;
-            }
-
-            perror("Receive error");
-            if (log_fp) {
-                write_json_log(log_fp, "error", "Failed to receive message", NULL, 0);
-            }
-            continue;
-        }
-
-        buffer[len] = '\0';
-        char client_ip[INET_ADDRSTRLEN];
-        inet_ntop(AF_INET, &(client_addr.sin_addr), client_ip, INET_ADDRSTRLEN);
-        int client_port = ntohs(client_addr.sin_port);
-
-        printf("Message from client %s:%d: %s\n",
-               client_ip, client_port, buffer);
-
-        if (log_fp) {
-            write_json_log(log_fp, "message_received", buffer, client_ip, client_port);
-        }
-
-        // Send response to client
-        sendto(server_fd, config.response_message, strlen(config.response_message), 0,
-               (const struct sockaddr *)&client_addr, client_len);
-
-        if (log_fp) {
-            write_json_log(log_fp, "message_sent", config.response_message, client_ip, client_port);
-        }
+    int result;
+    if (strcmp(config.mode, "proxy") == 0) {
+        result = run_proxy(server_fd, &config, log_fp);
+    } else if (strcmp(config.mode, "echo") == 0) {
+        result = run_echo(server_fd, &config, log_fp);
+    } else {
+        result = run_server(server_fd, &config, config_file, log_fp);
     }
 
-    free(buffer);
     close(server_fd);
     if (log_fp) {
         write_json_log(log_fp, "server_stop", "Server stopped", NULL, 0);
         fclose(log_fp);
     }
-    return 0;
+    return result == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -12,6 +12,7 @@
 #include <jansson.h>
 #include <time.h>
 #include <errno.h>
+#include <stdint.h>
 #include <netinet/ip.h>
 
 // Default configuration
@@ -19,6 +20,11 @@
 #define DEFAULT_BUFFER_SIZE 1024
 #define DEFAULT_RESPONSE "Message received"
 #define DEFAULT_LOG_FILE "udp_server.log"
+#define DEFAULT_BATCH_SIZE 32
+#define MAX_BATCH_SIZE 1024
+#define DEFAULT_HANDLER "reply"
+#define DEFAULT_MODE "server"
+#define DEFAULT_CONFIG_FILE "config.yaml"
 
 // Default socket options
 #define DEFAULT_REUSE_ADDR 1
@@ -28,11 +34,89 @@
 #define DEFAULT_TTL 64
 #define DEFAULT_RCVTIMEO 0
 
+// Default metrics settings
+#define DEFAULT_METRICS_FILE "udp_server_metrics.json"
+#define DEFAULT_METRICS_INTERVAL 0  // seconds, 0 = disabled
+
+// Default overload protection settings
+#define DEFAULT_OVERLOAD_INTERVAL_MS 100
+#define DEFAULT_OVERLOAD_HOLD_MS 2000
+#define DEFAULT_OVERLOAD_DROP_THRESHOLD 1
+#define DEFAULT_OVERLOAD_DELAY_THRESHOLD_US 5000
+#define DEFAULT_OVERLOAD_FILL_THRESHOLD 0.9
+#define DEFAULT_OVERLOAD_HYSTERESIS 0.5
+#define DEFAULT_BUSY_RESPONSE "Server busy"
+#define MAX_PRIORITY_RULES 16
+#define MAX_RULE_LENGTH 64
+
+// Default deferred request settings
+#define DEFAULT_MAX_PENDING 4096
+#define DEFAULT_ASYNC_TIMEOUT_MS 1000
+#define DEFAULT_ASYNC_THREADS 4
+#define DEFAULT_FALLBACK_RESPONSE "Request timed out"
+
+// Default proxy settings
+#define MAX_PROXY_BACKENDS 32
+#define DEFAULT_PROXY_BALANCE "consistent_hash"
+#define DEFAULT_PROXY_MAX_FLOWS 65536
+#define DEFAULT_PROXY_IDLE_TIMEOUT_MS 30000
+#define DEFAULT_PROXY_HEALTH_INTERVAL_MS 1000
+#define DEFAULT_PROXY_HEALTH_TIMEOUT_MS 500
+#define DEFAULT_PROXY_HEALTH_FAIL_THRESHOLD 3
+#define DEFAULT_PROXY_HEALTH_PAYLOAD "PING"
+
+// Default echo mode settings
+#define DEFAULT_ECHO_STAMP "none"
+#define DEFAULT_ECHO_STAMP_OFFSET 0
+#define ECHO_STAMP_SIZE 8  // bytes written by a stamp
+
+// Default pub/sub settings
+#define DEFAULT_PUBSUB_LEASE_SECONDS 60
+#define DEFAULT_PUBSUB_MAX_TOPICS 1024
+#define DEFAULT_PUBSUB_MAX_SUBSCRIPTIONS 65536
+#define DEFAULT_PUBSUB_FANOUT_BATCH 256
+
+// Default key-value store settings
+#define DEFAULT_KV_MEMORY_MB 64
+#define DEFAULT_KV_SHARDS 4
+#define MAX_KV_SHARDS 256
+
+// Payload filter limits
+#define MAX_FILTER_RULES 64
+
+// Authentication key entries ("id:hex key") in the configuration
+#define MAX_AUTH_KEYS 16
+
+// Default StatsD ingestion settings
+#define DEFAULT_STATSD_FLUSH_INTERVAL 10
+#define DEFAULT_STATSD_OUTPUT_FILE "statsd_aggregates.jsonl"
+#define DEFAULT_STATSD_MAX_METRICS 10000
+
+// Default tracing settings
+#define DEFAULT_TRACE_SAMPLE_EVERY 100
+#define DEFAULT_TRACE_RING_SIZE 65536
+#define MIN_TRACE_RING_SIZE 1024
+#define DEFAULT_TRACE_OUTPUT_FILE "udp_server_trace.json"
+
+// Default syslog sink settings
+#define DEFAULT_SYSLOG_DIRECTORY "."
+#define DEFAULT_SYSLOG_PREFIX "udp_sink"
+#define DEFAULT_SYSLOG_BUFFER_KB 1024
+#define MIN_SYSLOG_BUFFER_KB 16
+#define DEFAULT_SYSLOG_BUFFER_COUNT 16
+#define DEFAULT_SYSLOG_FLUSH_INTERVAL_MS 200
+#define DEFAULT_SYSLOG_SEGMENT_MB 256
+#define DEFAULT_SYSLOG_SEGMENT_SECONDS 3600
+#define DEFAULT_SYSLOG_FSYNC "segment"
+
 // Server configuration structure
 typedef struct {
+    char mode[32];
     int port;
     int buffer_size;
+    int batch_size;
     char response_message[256];
+    char handler[64];
     char log_file[256];
     int logging_enabled;
 
@@ -43,6 +127,87 @@ typedef struct {
     int broadcast;
     int ttl;
     int receive_timeout;
+
+    // Metrics
+    char metrics_file[256];
+    int metrics_interval;
+
+    // Overload protection
+    int overload_enabled;
+    int overload_interval_ms;
+    int overload_hold_ms;
+    double overload_drop_threshold;
+    double overload_delay_threshold_us;
+    double overload_fill_threshold;
+    double overload_hysteresis;
+    char busy_message[256];
+    char low_priority_clients[MAX_PRIORITY_RULES][MAX_RULE_LENGTH];
+    int low_priority_client_count;
+    char low_priority_prefixes[MAX_PRIORITY_RULES][MAX_RULE_LENGTH];
+    int low_priority_prefix_count;
+
+    // Deferred requests
+    int max_pending;
+    int async_timeout_ms;
+    int async_threads;
+    char fallback_message[256];
+
+    // Proxy mode
+    char proxy_backends[MAX_PROXY_BACKENDS][MAX_RULE_LENGTH];
+    int proxy_backend_count;
+    char proxy_balance[32];
+    int proxy_max_flows;
+    int proxy_idle_timeout_ms;
+    int proxy_health_interval_ms;
+    int proxy_health_timeout_ms;
+    int proxy_health_fail_threshold;
+    char proxy_health_payload[256];
+
+    // Echo mode
+    char echo_stamp[16];
+    int echo_stamp_offset;
+
+    // Pub/sub options
+    int pubsub_lease_seconds;
+    int pubsub_max_topics;
+    int pubsub_max_subscriptions;
+    int pubsub_fanout_batch;
+
+    // Key-value store options
+    int kv_memory_mb;
+    int kv_shards;
+
+    // Payload filter rules ("action:pattern")
+    char filter_rules[MAX_FILTER_RULES][MAX_RULE_LENGTH];
+    int filter_rule_count;
+    char filter_route_to[MAX_RULE_LENGTH];
+
+    // Datagram authentication
+    int auth_enabled;
+    char auth_keys[MAX_AUTH_KEYS][MAX_RULE_LENGTH];
+    int auth_key_count;
+
+    // StatsD ingestion options
+    int statsd_flush_interval;
+    char statsd_output_file[256];
+    int statsd_max_metrics;
+
+    // Syslog sink options
+    char syslog_directory[256];
+    char syslog_prefix[64];
+    int syslog_buffer_kb;
+    int syslog_buffer_count;
+    int syslog_flush_interval_ms;
+    int syslog_segment_mb;
+    int syslog_segment_seconds;
+    char syslog_fsync[16];
+    int syslog_direct_io;
+
+    // Stage tracing
+    int trace_enabled;
+    int trace_sample_every;
+    int trace_ring_size;
+    char trace_output_file[256];
 } ServerConfig;
 
 // Function declarations
@@ -50,5 +215,6 @@ ServerConfig load_config(const char *config_file);
 int apply_socket_options(int sockfd, const ServerConfig *config, FILE *log_fp);
 void write_json_log(FILE *log_fp, const char *event_type, const char *message,
                    const char *client_ip, int client_port);
+uint64_t monotonic_ms(void);
 
 #endif /* UDP_SERVER_H */